@@ -0,0 +1,136 @@
+// Compares the cost of pushing and running upload-sized tasks through the previous
+// `std::function` + mutex + `std::queue` design and through `AsyncTaskQueue`.
+
+#include "core/AsyncTaskQueue.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <queue>
+#include <vector>
+
+static std::atomic<std::size_t> allocation_count{0};
+
+void* operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (auto* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace {
+// Roughly the number of uploads that are queued after a large model finished loading
+constexpr std::size_t TASK_COUNT = 1'000;
+constexpr std::size_t ROUNDS = 2'000;
+
+// Roughly the captures of the texture upload closure: `this`, the texture and an optional `Image`
+struct UploadCaptures {
+    void* project;
+    void* texture;
+    std::array<std::byte, 48> image;
+};
+
+// The queue as it was before: one heap allocated closure per task and a single lock
+class BaselineQueue {
+public:
+    void push_task(std::function<void()> function)
+    {
+        auto lock = std::lock_guard<std::mutex>{m_mutex};
+        m_queue.push(std::move(function));
+    }
+
+    void run()
+    {
+        while (true) {
+            auto function = std::function<void()>{};
+            {
+                auto lock = std::lock_guard<std::mutex>{m_mutex};
+                if (m_queue.empty()) {
+                    return;
+                }
+                function = std::move(m_queue.front());
+                m_queue.pop();
+            }
+            function();
+        }
+    }
+
+private:
+    std::queue<std::function<void()>> m_queue;
+    std::mutex m_mutex;
+};
+
+struct Result {
+    double ns_per_task;
+    double allocations_per_task;
+};
+
+template <typename Queue>
+Result measure(Queue& queue)
+{
+    auto sum = std::size_t{0};
+    auto captures = UploadCaptures{};
+
+    auto best = Result{1e30, 0.0};
+    for (std::size_t round = 0; round < ROUNDS; ++round) {
+        auto const allocations_before = allocation_count.load();
+        auto const start = std::chrono::steady_clock::now();
+
+        for (std::size_t i = 0; i < TASK_COUNT; ++i) {
+            queue.push_task([&sum, captures, i]() {
+                sum += i + static_cast<std::size_t>(captures.image[0]);
+            });
+        }
+        queue.run();
+
+        auto const elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+        auto const allocations = allocation_count.load() - allocations_before;
+
+        auto const ns_per_task = elapsed.count() / TASK_COUNT;
+        if (ns_per_task < best.ns_per_task) {
+            best = Result{ns_per_task, static_cast<double>(allocations) / TASK_COUNT};
+        }
+    }
+
+    if (sum == 0) {
+        std::cout << "unexpected sum\n";
+    }
+
+    return best;
+}
+
+void print(char const* name, Result result)
+{
+    std::cout << name << ": " << result.ns_per_task << " ns/task, "
+              << result.allocations_per_task << " allocations/task\n";
+}
+}
+
+int main()
+{
+    std::cout << "push + run of " << TASK_COUNT << " tasks with " << sizeof(UploadCaptures)
+              << " bytes of captures, best of " << ROUNDS << " rounds\n";
+
+    auto baseline = BaselineQueue{};
+    print("std::function + std::queue", measure(baseline));
+
+    // A queue without workers, drained by the calling thread like `AsyncTaskQueue::main`
+    auto queue = AsyncTaskQueue{};
+    print("AsyncTaskQueue", measure(queue));
+}
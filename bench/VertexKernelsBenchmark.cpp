@@ -0,0 +1,109 @@
+// Compares the scalar and the SIMD import kernels on a synthetic mesh with a million vertices.
+
+#include "core/VertexKernels.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr std::size_t VERTEX_COUNT = 1'000'000;
+constexpr std::size_t ROUNDS = 50;
+
+// Attribute arrays as assimp stores them, 3 floats per vertex
+struct SourceMesh {
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> tex_coords;
+};
+
+SourceMesh create_source_mesh()
+{
+    auto random = std::mt19937{42};
+    auto distribution = std::uniform_real_distribution<float>{-1000.0f, 1000.0f};
+
+    auto mesh = SourceMesh{
+        .positions = std::vector<float>(VERTEX_COUNT * 3),
+        .normals = std::vector<float>(VERTEX_COUNT * 3),
+        .tex_coords = std::vector<float>(VERTEX_COUNT * 3),
+    };
+    for (auto* values : {&mesh.positions, &mesh.normals, &mesh.tex_coords}) {
+        for (auto& value : *values) {
+            value = distribution(random);
+        }
+    }
+
+    return mesh;
+}
+
+// Best time of all rounds in nanoseconds per vertex
+template <typename F>
+double measure(F&& function)
+{
+    auto best = 1e30;
+    for (std::size_t round = 0; round < ROUNDS; ++round) {
+        auto const start = std::chrono::steady_clock::now();
+        function();
+        auto const elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+        best = std::min(best, elapsed.count() / VERTEX_COUNT);
+    }
+
+    return best;
+}
+
+void print(char const* name, double scalar_ns, double simd_ns)
+{
+    std::cout << name << ": scalar " << scalar_ns << " ns/vertex, SIMD " << simd_ns
+              << " ns/vertex (" << scalar_ns / simd_ns << "x)\n";
+}
+}
+
+int main()
+{
+    std::cout << VERTEX_COUNT << " vertices, best of " << ROUNDS << " rounds\n";
+
+    auto const source = create_source_mesh();
+    auto scalar_vertices = std::vector<Vertex>(VERTEX_COUNT);
+    auto simd_vertices = std::vector<Vertex>(VERTEX_COUNT);
+
+    auto const interleave_scalar = measure([&]() {
+        VertexKernels::interleave_scalar(scalar_vertices, source.positions.data(), source.normals.data(), source.tex_coords.data());
+    });
+    auto const interleave_simd = measure([&]() {
+        VertexKernels::interleave(simd_vertices, source.positions.data(), source.normals.data(), source.tex_coords.data());
+    });
+    print("interleave", interleave_scalar, interleave_simd);
+
+    auto is_correct = std::memcmp(scalar_vertices.data(), simd_vertices.data(), VERTEX_COUNT * sizeof(Vertex)) == 0;
+
+    // Moving back and forth keeps the positions in range over all rounds
+    auto offset = glm::vec3{10.0f, -20.0f, 30.0f};
+    auto const translate_scalar = measure([&]() {
+        VertexKernels::translate_scalar(scalar_vertices, offset);
+        offset = -offset;
+    });
+    auto const translate_simd = measure([&]() {
+        VertexKernels::translate(simd_vertices, offset);
+        offset = -offset;
+    });
+    print("translate", translate_scalar, translate_simd);
+
+    is_correct = is_correct && std::memcmp(scalar_vertices.data(), simd_vertices.data(), VERTEX_COUNT * sizeof(Vertex)) == 0;
+
+    auto scalar_aabb = AABB{};
+    auto simd_aabb = AABB{};
+    auto const aabb_scalar = measure([&]() {
+        scalar_aabb = VertexKernels::compute_aabb_scalar(scalar_vertices);
+    });
+    auto const aabb_simd = measure([&]() {
+        simd_aabb = VertexKernels::compute_aabb(simd_vertices);
+    });
+    print("compute_aabb", aabb_scalar, aabb_simd);
+
+    is_correct = is_correct && scalar_aabb.min == simd_aabb.min && scalar_aabb.max == simd_aabb.max;
+    if (!is_correct) {
+        std::cout << "SIMD results differ from the scalar results\n";
+        return 1;
+    }
+}
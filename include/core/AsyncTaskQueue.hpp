@@ -1,13 +1,79 @@
 #pragma once
 
+#include "core/Task.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <optional>
 #include <thread>
+#include <vector>
 
 class AsyncTaskQueue {
 public:
+    // Tasks with a higher priority are always started first. Within a priority, queues without workers are FIFO.
+    // Otherwise the order is unspecified: workers take the newest task from their own deque and steal the oldest.
+    enum class Priority {
+        VISIBLE_NOW, // Needed for the current frame
+        VISIBLE_SOON, // Part of the scene, but not in view
+        PREFETCH, // Not needed yet
+    };
+    static constexpr std::size_t PRIORITY_COUNT = 3;
+
+    // Pooled and reference counted by the queue entries and handles that point to it.
+    // Nodes are recycled, so pushing a task doesn't allocate once the pool is warmed up.
+    struct TaskNode {
+        Task function;
+        std::atomic<Priority> priority{Priority::VISIBLE_SOON};
+        std::atomic<bool> claimed{false};
+        std::atomic<bool> cancelled{false};
+        std::atomic<std::size_t> references{0};
+        TaskNode* next_free{nullptr};
+    };
+
+    // Refers to a pushed task. Can be used to change its priority or to cancel it before it started.
+    // A default constructed handle doesn't refer to any task.
+    class TaskHandle {
+    public:
+        TaskHandle() = default;
+        TaskHandle(TaskHandle const&);
+        TaskHandle(TaskHandle&&);
+        TaskHandle& operator=(TaskHandle const&);
+        TaskHandle& operator=(TaskHandle&&);
+        ~TaskHandle();
+
+        // Returns true if the task didn't start yet and will never run
+        bool cancel();
+        // Requeues the task with a higher priority. Lowering the priority has no effect.
+        void set_priority(Priority);
+        [[nodiscard]] Priority priority() const;
+        [[nodiscard]] bool is_valid() const;
+        [[nodiscard]] bool is_cancelled() const;
+        // True once the task started running or got cancelled
+        [[nodiscard]] bool is_claimed() const;
+
+    private:
+        friend AsyncTaskQueue;
+
+        // Takes over one reference of the node
+        TaskHandle(AsyncTaskQueue*, TaskNode*);
+
+        AsyncTaskQueue* m_queue{nullptr};
+        TaskNode* m_node{nullptr};
+    };
+
+    struct RunResult {
+        std::size_t tasks_run{0};
+        // Tasks that didn't fit into the time budget
+        std::size_t tasks_left{0};
+        // Negative if the last task exceeded the budget
+        std::chrono::microseconds time_left{0};
+    };
+
     static void init();
     static void shutdown();
     static AsyncTaskQueue background;
@@ -17,18 +83,69 @@ private:
     static std::vector<std::thread> threadpool;
 
 public:
+    AsyncTaskQueue() = default;
+    AsyncTaskQueue(AsyncTaskQueue const&) = delete;
+    ~AsyncTaskQueue();
+
     void run();
+    // Runs tasks until the queue is empty or the time budget is used up. At least one task is run,
+    // so the queue always makes progress even if a single task exceeds the budget.
+    RunResult run_for(std::chrono::microseconds budget);
     void run_blocking();
-    void push_task(std::function<void()>);
+    // Blocks until tasks are queued or the queue is closed, e.g. to drain `main` while waiting for loads
+    void wait_for_tasks();
+    // Calls `function` for every index in [0, count) on the workers of this queue and returns once all calls finished.
+    // The calling thread works on the indices too, so this may be called from the main thread and from tasks of this queue.
+    // `function` must not throw.
+    void parallel_for(std::size_t count, std::function<void(std::size_t)> const& function, Priority = Priority::VISIBLE_SOON);
+    TaskHandle push_task(Task, Priority = Priority::VISIBLE_SOON);
     void close();
     bool is_open();
     std::size_t num_queued_tasks();
     std::size_t num_total_queued_tasks();
+    std::size_t num_workers() const;
+    // Result of the last `run_for` call. Only meaningful for queues that are drained by a single thread.
+    RunResult last_run_result() const;
 
 private:
-    std::queue<std::function<void()>> m_queue;
+    // A task that was requeued with a higher priority is referenced by multiple entries.
+    // Whichever entry is popped first claims the task, the others are discarded.
+    using Entry = TaskNode*;
+    using PriorityQueues = std::array<std::deque<Entry>, PRIORITY_COUNT>;
+
+    // Every worker thread owns one set of deques. The owner pushes and pops at the back, so nested tasks
+    // run while their data is still warm in the cache. Idle workers steal the oldest task from the
+    // front of another worker's deque. Each worker has its own mutex, so there is no global lock.
+    struct Worker {
+        PriorityQueues tasks;
+        std::mutex mutex;
+        // Number of tasks that were ever pushed onto this deque
+        std::atomic<std::size_t> total_tasks{0};
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // Queues without workers (like `main`) only use these deques.
+    PriorityQueues m_queue;
     std::mutex m_queue_mutex;
+    std::atomic<std::size_t> m_queue_total_tasks{0};
+
+    std::mutex m_sleep_mutex;
     std::condition_variable m_convar;
-    bool m_is_open{true};
-    std::size_t m_total_queued_tasks{0};
+    std::atomic<bool> m_is_open{true};
+    std::atomic<std::size_t> m_num_queued_tasks{0};
+    std::atomic<std::size_t> m_num_sleeping_threads{0};
+    std::atomic<std::size_t> m_next_worker{0};
+    RunResult m_last_run_result;
+
+    void start_workers(std::size_t count);
+    void run_worker(std::size_t index);
+    void wake_one();
+    // Requeued tasks are not counted as new tasks
+    void push_entry(Entry, Priority, bool is_new_task);
+    // Returns a claimed node, the reference of the popped entry is passed to the caller
+    TaskNode* pop_task(std::optional<std::size_t> worker_index);
+    Entry pop_entry(std::optional<std::size_t> worker_index);
+    Entry steal_entry(std::size_t first_victim, std::size_t priority);
+    void run_task(TaskNode*);
 };
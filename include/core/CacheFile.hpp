@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Helpers for the binary cache files in the project's cache directory (meshes, textures).
+ * Values are written in native byte order, strings as length + characters, optional paths with a leading flag byte.
+ * Arrays start at offsets that are a multiple of `ARRAY_ALIGNMENT`, so they can be used directly from a mapped file.
+ */
+struct CacheFile {
+    // Stored in the header of a cache file, the cache is stale once the source was modified
+    static std::int64_t source_mtime(std::filesystem::path const& source);
+    // Writes to a temporary file first and renames it, so a crash never leaves a half written cache behind.
+    // Returns false if the file couldn't be written, filesystem errors are thrown.
+    static bool write(std::filesystem::path const& cache_file, std::span<std::byte const> data);
+};
+
+constexpr std::size_t ARRAY_ALIGNMENT = 16;
+
+class CacheWriter {
+public:
+    template <typename T>
+    void write(T const& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        auto const* bytes = reinterpret_cast<std::byte const*>(&value);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void write_string(std::string_view string)
+    {
+        write(static_cast<std::uint32_t>(string.size()));
+        auto const* bytes = reinterpret_cast<std::byte const*>(string.data());
+        m_buffer.insert(m_buffer.end(), bytes, bytes + string.size());
+    }
+
+    void write_path(std::optional<std::filesystem::path> const& path)
+    {
+        write(static_cast<std::uint8_t>(path.has_value()));
+        if (path.has_value()) {
+            write_string(path->generic_string());
+        }
+    }
+
+    template <typename T>
+    void write_array(std::vector<T> const& values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write_bytes(std::as_bytes(std::span{values}));
+    }
+
+    void write_bytes(std::span<std::byte const> bytes)
+    {
+        m_buffer.resize((m_buffer.size() + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT);
+        m_buffer.insert(m_buffer.end(), bytes.begin(), bytes.end());
+    }
+
+    std::vector<std::byte> const& buffer() const
+    {
+        return m_buffer;
+    }
+
+private:
+    std::vector<std::byte> m_buffer;
+};
+
+// Every read is bounds checked, a truncated or corrupted file makes the reader fail instead of crashing.
+class CacheReader {
+public:
+    CacheReader(std::span<std::byte const> data)
+        : m_data{data}
+    { }
+
+    template <typename T>
+    bool read(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (m_offset + sizeof(T) > m_data.size()) {
+            return false;
+        }
+
+        std::memcpy(&value, m_data.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    bool read_string(std::string& string)
+    {
+        std::uint32_t size;
+        if (!read(size) || m_offset + size > m_data.size()) {
+            return false;
+        }
+
+        string.assign(reinterpret_cast<char const*>(m_data.data() + m_offset), size);
+        m_offset += size;
+        return true;
+    }
+
+    bool read_path(std::optional<std::filesystem::path>& path)
+    {
+        std::uint8_t has_value;
+        if (!read(has_value)) {
+            return false;
+        }
+
+        if (!has_value) {
+            path = {};
+            return true;
+        }
+
+        std::string string;
+        if (!read_string(string)) {
+            return false;
+        }
+
+        path = std::filesystem::path{string};
+        return true;
+    }
+
+    // Points into the data instead of copying it. The mapping starts at a page boundary and arrays
+    // are aligned within the file, so the elements are correctly aligned.
+    template <typename T>
+    bool read_span(std::span<T const>& values, std::size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= ARRAY_ALIGNMENT);
+        m_offset = (m_offset + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT;
+        if (m_offset > m_data.size() || count > (m_data.size() - m_offset) / sizeof(T)) {
+            return false;
+        }
+
+        values = {reinterpret_cast<T const*>(m_data.data() + m_offset), count};
+        m_offset += count * sizeof(T);
+        return true;
+    }
+
+private:
+    std::span<std::byte const> m_data;
+    std::size_t m_offset{0};
+};
@@ -12,6 +12,8 @@ struct Config {
     float fov{glm::radians(90.0f)}; // Vertical fov in radians
     float near{10.0f};
     float far{100000.0f};
+    float lod_pixel_error{1.0f}; // Largest simplification error in pixels that is accepted when picking the LOD of a mesh
+    float hlod_pixel_size{64.0f}; // Subtrees that are smaller on screen are drawn as a single merged proxy, 0 disables proxies
 
     // camera
     CameraController::Type camera_controller_type{CameraController::Type::UNITY};
@@ -27,4 +29,19 @@ struct Config {
     float gizmo_snap_translation{100.0f};
     float gizmo_snap_rotation{10.0f};
     float gizmo_snap_scale{0.1f};
+
+    // streaming
+    float main_thread_budget{4.0f}; // Time per frame in milliseconds for texture uploads and other main thread tasks
+    bool keep_mesh_data{false}; // Keep vertices and indices in RAM after they are uploaded to the GPU
+    bool compress_textures{true}; // Block compress textures with mipmaps and cache them on disk, uses 4-6x less VRAM
+    float texture_memory_budget{2048.0f}; // VRAM for textures in MiB, the least recently used ones are unloaded beyond it. 0 disables the limit
+
+    // import
+    bool quantize_vertices{false}; // Store vertices of newly imported models in half the memory, at a small loss of precision
+    bool weld_vertices{true}; // Merge duplicate vertices of newly imported models
+    float weld_position_epsilon{0.0f}; // Largest difference per component of welded vertices, 0 only merges exact duplicates
+    float weld_normal_epsilon{0.0f};
+    float weld_tex_coords_epsilon{0.0f};
+    bool optimize_meshes{true}; // Reorder triangles and vertices of newly imported models for the GPU caches
+    bool generate_lods{true}; // Build simplified LODs for the meshes of newly imported models
 };
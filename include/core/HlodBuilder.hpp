@@ -0,0 +1,69 @@
+#pragma once
+
+#include "core/Scene.hpp"
+#include "renderer/Mesh.hpp"
+#include "renderer/Texture.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct HlodSourceMesh {
+    Mesh const* mesh;
+    glm::mat4 matrix; // Into the space of the subtree root
+    glm::vec2 tex_coords; // Center of the atlas cell of the mesh texture
+    MeshGeometry geometry; // Filled by `HlodBuilder::read_geometry`
+};
+
+// All meshes below an `InstancedNode` and one atlas cell per texture.
+// Each mesh and cell is read by its own task, so the GPU readbacks are spread over multiple frames.
+struct HlodSource {
+    std::vector<HlodSourceMesh> meshes;
+    // Indexed by atlas cell
+    std::vector<Texture const*> textures;
+    // Average color of each atlas cell, RGB. Filled by `HlodBuilder::read_color`.
+    std::vector<std::uint8_t> cell_colors;
+};
+
+struct HlodGeometry {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    Image atlas;
+    AABB aabb;
+};
+
+// A single merged mesh that is drawn instead of a subtree that is small on screen
+struct HlodProxy {
+    Texture atlas;
+    Mesh mesh;
+    // `InstancedNode::subtree_hash` of the subtree the proxy was built from
+    std::size_t subtree_hash;
+
+    HlodProxy(Texture atlas, HlodGeometry, Texture const* texture_opacity, std::size_t subtree_hash);
+    HlodProxy(HlodProxy const&) = delete;
+    HlodProxy& operator=(HlodProxy const&) = delete;
+    ~HlodProxy();
+};
+
+/*
+ * Builds hierarchical LOD proxies. Every mesh of a subtree is merged into one mesh and simplified, so far away city
+ * blocks are a single draw call. Distant proxies only cover a few pixels, so the texture of each mesh is baked
+ * into a single texel of its average color.
+ */
+struct HlodBuilder {
+    // Smaller subtrees are drawn mesh by mesh, their LODs are good enough
+    static constexpr std::size_t MIN_MESHES = 8;
+
+    // Lists the meshes and textures of the subtree without reading them, must run on the main thread.
+    // Every mesh and texture of the subtree must be loaded.
+    static HlodSource collect(InstancedNode const&);
+    // Reads the mapped cache or the CPU copy if the mesh has one, which works on any thread.
+    // Otherwise the geometry is read back from the GPU, see `Mesh::needs_readback`.
+    static void read_geometry(HlodSourceMesh&);
+    // Reads the average color of the texture of a cell back from the GPU, must run on the main thread
+    static void read_color(HlodSource&, std::size_t cell);
+    // Merges and simplifies the geometry without touching any GL state, so it can run on a background thread.
+    // `target_error` is the largest accepted simplification error relative to the size of the subtree.
+    static HlodGeometry build(HlodSource, float target_error);
+    // Uploads the proxy, must be called on the main thread
+    static std::unique_ptr<HlodProxy> create_proxy(HlodGeometry, Texture const* texture_opacity, std::size_t subtree_hash);
+};
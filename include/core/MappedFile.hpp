@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+// Read-only memory mapping of a whole file. The pages are loaded lazily by the OS, so only the parts
+// that are actually read are copied into memory.
+class MappedFile {
+public:
+    static std::optional<MappedFile> open(std::filesystem::path);
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    MappedFile(MappedFile&&);
+    MappedFile& operator=(MappedFile&&);
+    ~MappedFile();
+
+    [[nodiscard]] std::span<std::byte const> data() const;
+
+private:
+    MappedFile() = default;
+    void unmap();
+
+    std::byte const* m_data{nullptr};
+    std::size_t m_size{0};
+#ifdef _WIN32
+    void* m_mapping{nullptr};
+#endif
+};
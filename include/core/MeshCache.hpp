@@ -0,0 +1,19 @@
+#pragma once
+
+#include "core/ModelLoader.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+/*
+ * Stores imported models in a compact binary file, so they don't have to go through assimp on every launch.
+ * A cache file is only valid for the source path, modification time, import flags and options it was created with.
+ * Vertex and index arrays are aligned within the file, so they can be used directly from a mapped file.
+ */
+struct MeshCache {
+    static constexpr std::uint32_t VERSION = 8;
+
+    static std::filesystem::path cache_file(std::filesystem::path cache_directory, std::filesystem::path source);
+    static std::optional<ImportedNode> load(std::filesystem::path cache_file, std::filesystem::path source, unsigned int import_flags, ImportOptions const&);
+    static bool store(std::filesystem::path cache_file, std::filesystem::path source, unsigned int import_flags, ImportOptions const&, ImportedNode const&);
+};
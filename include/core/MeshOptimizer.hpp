@@ -0,0 +1,42 @@
+#pragma once
+
+#include "renderer/Mesh.hpp"
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Largest difference per component for two vertices to be welded. 0 only welds exact duplicates.
+struct WeldTolerance {
+    float position{0.0f};
+    float normal{0.0f};
+    float tex_coords{0.0f};
+
+    bool operator==(WeldTolerance const&) const = default;
+};
+
+/*
+ * Prepares imported geometry for the GPU. Welding merges duplicate vertices, simplification builds LODs
+ * and the optimisations reorder the geometry without changing what is drawn.
+ * Triangles are ordered for the post-transform vertex cache (Tom Forsyth, "Linear-Speed Vertex Cache
+ * Optimisation"), then vertices are ordered by first use, so vertex fetches walk through memory linearly.
+ */
+struct MeshOptimizer {
+    // Size of the simulated FIFO cache used for measuring, typical for current GPUs
+    static constexpr std::size_t MEASURED_CACHE_SIZE = 16;
+
+    // Merges vertices that are within the tolerance of each other and remaps the indices.
+    // Triangles that collapse are removed. Returns the number of removed vertices.
+    static std::size_t weld_vertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, WeldTolerance const&);
+    // Average cache miss ratio: vertex shader invocations per triangle. 3 is the worst case, 0.5 the optimum for large grids.
+    static float acmr(std::span<unsigned int const> indices, std::size_t vertex_count, std::size_t cache_size = MEASURED_CACHE_SIZE);
+    static void optimize_vertex_cache(std::vector<unsigned int>& indices, std::size_t vertex_count);
+    // Also drops vertices that are not referenced by any triangle
+    static void optimize_vertex_fetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    // Collapses edges (Garland and Heckbert quadric error metrics) until at most `target_index_count` indices are left,
+    // or until the next collapse would move the surface further than `target_error`. The remaining triangles reuse
+    // the existing vertices. Returns the largest error of the applied collapses.
+    static float simplify(std::span<Vertex const> vertices, std::vector<unsigned int>& indices, std::size_t target_index_count, float target_error);
+    // Appends up to three simplified LODs to `indices` and returns the ranges of all LODs, starting with the full mesh
+    static std::vector<MeshLod> generate_lods(std::span<Vertex const> vertices, std::vector<unsigned int>& indices, AABB const&);
+};
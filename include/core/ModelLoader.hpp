@@ -1,8 +1,57 @@
 #pragma once
 
+#include "core/MeshOptimizer.hpp"
 #include "core/Scene.hpp"
+#include <assimp/postprocess.h>
+#include <atomic>
 #include <filesystem>
+#include <optional>
+#include <string>
+
+// CPU side of a mesh. Textures are only referenced by path, because they must be requested on the main thread.
+struct ImportedMesh {
+    std::vector<Vertex> vertices;
+    // Replaces `vertices` if the model was imported with `VertexFormat::QUANTIZED`
+    std::vector<QuantizedVertex> quantized_vertices;
+    // Contains the indices of all LODs
+    std::vector<unsigned int> indices;
+    // Empty if the mesh has no simplified LODs
+    std::vector<MeshLod> lods;
+    // Used instead of the vectors if the mesh was loaded from the mesh cache
+    MappedGeometry mapped_geometry;
+    std::optional<std::filesystem::path> texture_diffuse;
+    std::optional<std::filesystem::path> texture_opacity;
+    // Name of a diffuse texture that wasn't found, empty otherwise. It is looked up again whenever the mesh is
+    // loaded from the mesh cache, so a texture that is added later is picked up.
+    std::string unresolved_texture_diffuse;
+    AABB aabb;
+};
+
+struct ImportedNode {
+    Transform transform;
+    std::vector<ImportedNode> children;
+    std::vector<ImportedMesh> meshes;
+    std::string name;
+    NodeLocation location;
+};
+
+// Settings that change the imported geometry, so they are part of the mesh cache key
+struct ImportOptions {
+    VertexFormat vertex_format{VertexFormat::FLOAT};
+    bool weld_vertices{true};
+    WeldTolerance weld_tolerance;
+    bool optimize_meshes{true}; // Reorder triangles and vertices for the GPU caches
+    bool generate_lods{true};
+};
 
 struct ModelLoader {
-    static std::optional<Node> load_model(std::filesystem::path path);
+    // Changing the flags invalidates the mesh cache. The AABBs are computed while converting the meshes.
+    static constexpr unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+    // Parses and converts the model without touching any GL state, so it can run on a background thread.
+    // `progress` is set to values between 0 and 1 while importing.
+    static std::optional<ImportedNode> import_model(std::filesystem::path path, ImportOptions options, std::atomic<float>* progress = nullptr);
+    // Requests the textures of the imported model, must be called on the main thread.
+    // The mesh buffers are not set up yet.
+    static Node create_node(ImportedNode);
 };
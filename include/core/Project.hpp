@@ -1,9 +1,17 @@
 #pragma once
 
+#include "core/AsyncTaskQueue.hpp"
 #include "core/Config.hpp"
+#include "core/HlodBuilder.hpp"
 #include "core/Scene.hpp"
+#include "core/TaskGraph.hpp"
+#include "core/UnityMaterial.hpp"
+#include "renderer/PixelBufferPool.hpp"
 #include "renderer/Texture.hpp"
+#include <atomic>
 #include <filesystem>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
 
 // Needed when using glm::vec4 as key in std::unordered_map
@@ -24,6 +32,8 @@ struct FSCacheNode {
     std::filesystem::file_time_type mtime;
     Type type;
     std::vector<FSCacheNode> children;
+    // Read from the `.meta` file of textures, so it is only read again if the directory changed
+    std::optional<std::string> unity_guid;
 
     FSCacheNode* get_child(std::filesystem::path);
 };
@@ -39,14 +49,38 @@ public:
     static Project* load(std::filesystem::path);
     void store();
 
+    // Generated files like the mesh cache, hidden from the asset browser
+    std::filesystem::path cache_directory() const;
     FSCacheNode* get_fs_cache();
     FSCacheNode* get_fs_cache(std::filesystem::path);
     std::optional<std::filesystem::path> get_fs_cache_from_guid(std::string const&) const;
-    Texture const* get_texture(std::filesystem::path);
+    // Textures anywhere in the project with the given file name, compared case-insensitively.
+    // Only looks at the fs cache, so it doesn't touch the filesystem. Paths are lexically normalized.
+    std::vector<std::filesystem::path> find_textures_by_filename(std::string const&) const;
+    // Unity materials are parsed when the fs cache is rebuilt, so this doesn't touch the filesystem.
+    // Returns nullptr if there is no material at the given path.
+    std::shared_ptr<UnityMaterial const> get_unity_material(std::filesystem::path const&) const;
+    Texture const* get_texture(std::filesystem::path, AsyncTaskQueue::Priority = AsyncTaskQueue::Priority::PREFETCH);
+    // Raises the priority of a pending texture load or restarts it if it was cancelled.
+    void request_texture(Texture const*, AsyncTaskQueue::Priority);
+    // Cancels pending texture loads that are only used by the given instance, which was removed from the scene.
+    void release_textures(InstancedNode const&);
+    // Returns right away. Models that are not loaded yet are imported in the background and
+    // the returned placeholder node is filled in once the import finished.
     Node* get_model(std::filesystem::path);
     Node* get_cached_model(std::filesystem::path);
+    // Progress between 0 and 1 of a model that is still loading
+    std::optional<float> model_load_progress(Node const*) const;
+    std::size_t num_model_loads() const;
+    // Blocks until all pending models are loaded, e.g. before resolving the nodes of a scene file
+    void wait_for_models();
     Node* get_node(NodeLocation);
+    // Returns the merged proxy of the subtree if it is up to date. Otherwise a rebuild is queued in the background
+    // and nullptr is returned, so the subtree is drawn as is until the proxy is ready.
+    HlodProxy const* get_hlod_proxy(InstancedNode const&);
     void update(double current_time);
+    // Incremented by every `update`, textures that are drawn are stamped with it
+    std::uint64_t frame() const;
     Texture const* fallback_texture() const;
     Texture const* white_texture() const;
 
@@ -56,13 +90,79 @@ private:
 
     ColorTexture m_fallback_texture{ColorTexture::single_color(glm::vec4{1.0f})};
     ColorTexture m_white_texture{ColorTexture::single_color(glm::vec4{1.0f})};
+    // Declared before the loads, whose stages may still hold buffers of the pool
+    PixelBufferPool m_pixel_buffers;
     std::unordered_map<std::filesystem::path, Texture> m_textures;
+
+    struct TextureLoad {
+        std::filesystem::path path;
+        TaskGraph graph;
+    };
+    // Textures that are not uploaded yet or were evicted
+    std::unordered_map<Texture const*, TextureLoad> m_texture_loads;
+    // Estimated VRAM of the loaded textures, kept below `Config::texture_memory_budget` by `evict_textures`
+    std::size_t m_texture_memory{0};
+    std::size_t m_evicted_textures{0};
+    std::uint64_t m_frame{0};
     std::unordered_map<std::filesystem::path, Node> m_models;
+
+    struct ModelLoad {
+        TaskGraph graph;
+        // Written by the import task
+        std::shared_ptr<std::atomic<float>> import_progress;
+        std::size_t meshes_total{0};
+        std::size_t meshes_uploaded{0};
+    };
+    // Models that are not completely loaded yet, keyed by their placeholder
+    std::unordered_map<Node const*, ModelLoad> m_model_loads;
+
+    struct HlodEntry {
+        std::unique_ptr<HlodProxy> proxy;
+        std::optional<TaskGraph> build;
+        std::size_t build_subtree_hash{0};
+        // Proxies that weren't drawn for a while are freed
+        double last_used{0};
+        // Subtrees that are still loading are checked again later
+        double retry_time{0};
+    };
+    // Keyed by `InstancedNode::id`
+    std::unordered_map<unsigned int, HlodEntry> m_hlod_proxies;
+    double m_current_time{0};
+
+    // Everything that is derived from the files of the project. Scanned in the background and swapped in on the main thread.
+    struct FSCacheSnapshot {
+        std::unique_ptr<FSCacheNode> root;
+        std::unordered_map<std::string, std::filesystem::path> guid_mappings;
+        std::unordered_map<std::string, std::vector<std::filesystem::path>> texture_index;
+        std::unordered_map<std::filesystem::path, std::shared_ptr<UnityMaterial const>> unity_materials;
+    };
+
+    // Only replaced on the main thread, the background scan reads it while the main thread doesn't write it
     std::unique_ptr<FSCacheNode> m_fs_cache;
     double m_fs_cache_last_updated{0};
+    std::optional<TaskGraph> m_fs_scan;
     std::unordered_map<std::string, std::filesystem::path> m_guid_mappings;
+    // Guids are resolved by model imports on background threads
+    mutable std::mutex m_guid_mutex;
+    // Lower case file names of all textures in the fs cache, rebuilt with the cache
+    std::unordered_map<std::string, std::vector<std::filesystem::path>> m_texture_index;
+    // Texture names are resolved by model imports on background threads
+    mutable std::mutex m_texture_index_mutex;
+    // Keyed by the lexically normalized path of the `.mat` file
+    std::unordered_map<std::filesystem::path, std::shared_ptr<UnityMaterial const>> m_unity_materials;
+    mutable std::mutex m_unity_materials_mutex;
 
     Project(std::filesystem::path);
+    void queue_texture_load(std::filesystem::path, AsyncTaskQueue::Priority);
+    // Unloads the least recently used textures while over budget, they are loaded again by `request_texture`
+    void evict_textures();
+    void queue_model_load(std::filesystem::path, Node* placeholder);
+    void queue_hlod_build(InstancedNode const&);
+    void queue_fs_scan();
+    // Scans and applies the snapshot right away, only used when the project is opened
     void rebuild_fs_cache();
-    void rebuild_fs_cache_helper(FSCacheNode&);
+    // Reuses the unchanged directories and materials of the current snapshot, can run on a background thread
+    FSCacheSnapshot scan_fs_cache() const;
+    // Must be called on the main thread
+    void apply_fs_cache(FSCacheSnapshot);
 };
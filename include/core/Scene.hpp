@@ -5,6 +5,7 @@
 #include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include <optional>
 #include <vector>
 
 class Mesh;
@@ -33,14 +34,23 @@ struct InstancedNode {
     std::vector<std::unique_ptr<InstancedNode>> children;
     std::string name;
 
+    // Summary of the subtree for drawing it as a HLOD proxy, updated by `compute_transforms`
+    std::optional<AABB> bounds{}; // World space, empty if there are no meshes
+    std::size_t mesh_count{0};
+    // Changes when a transform below this node or the structure of the subtree changes, but not with the own transform
+    std::size_t subtree_hash{0};
+
     static unsigned int counter;
     unsigned int const id{counter++};
 
     void traverse(std::function<void(glm::mat4, Node const&)>) const;
+    // Must be called after changing transforms or children, it also updates the subtree summaries
     void compute_transforms(glm::mat4 = glm::mat4{1.0f});
 
     // This function is slow and should only be sparingly used and only when absolutely necessary.
     [[nodiscard]] InstancedNode* find_parent(InstancedNode& scene) const;
+    // Same as `find_parent`, returns the node with the given id in this subtree
+    [[nodiscard]] InstancedNode const* find(unsigned int id) const;
 };
 
 struct NodeLocation {
@@ -58,6 +68,8 @@ struct Node {
     std::vector<Mesh> meshes;
     std::string name;
     NodeLocation location;
+    // Placeholder of a model that is still being imported
+    bool is_loading{false};
 
     static Node create(std::string name, Transform transform, NodeLocation location);
     [[nodiscard]] std::unique_ptr<InstancedNode> instantiate() const;
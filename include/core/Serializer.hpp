@@ -25,6 +25,7 @@ private:
     [[nodiscard]] nlohmann::json serialize(Config const&) const;
     [[nodiscard]] nlohmann::json serialize(Uniforms const&) const;
 
+    void request_models(nlohmann::json& source) const;
     std::unique_ptr<InstancedNode> deserialize_unique_ptr_instancednode(nlohmann::json& source) const;
     Config deserialize_config(nlohmann::json& source) const;
     Uniforms deserialize_uniforms(nlohmann::json& source) const;
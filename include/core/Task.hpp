@@ -0,0 +1,121 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+ * A move-only `void()` callable that stores small closures inline instead of on the heap.
+ * Unlike `std::function`, the inline buffer is large enough for the closures used by the loaders
+ * (e.g. a moved `Image` plus a few pointers), so queueing them doesn't allocate.
+ * Larger closures still work, but fall back to a heap allocation.
+ */
+class Task {
+public:
+    static constexpr std::size_t INLINE_CAPACITY = 96;
+
+    Task() = default;
+
+    template <typename F>
+        requires(!std::same_as<std::remove_cvref_t<F>, Task> && std::invocable<std::remove_cvref_t<F>&>)
+    Task(F&& function)
+    {
+        using Function = std::remove_cvref_t<F>;
+
+        if constexpr (fits_inline<Function>()) {
+            new (m_storage) Function(std::forward<F>(function));
+            m_vtable = &inline_vtable<Function>;
+        } else {
+            new (m_storage) Function*(new Function(std::forward<F>(function)));
+            m_vtable = &heap_vtable<Function>;
+        }
+    }
+
+    Task(Task const&) = delete;
+    Task& operator=(Task const&) = delete;
+
+    Task(Task&& other) noexcept
+    {
+        move_from(other);
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+
+        return *this;
+    }
+
+    ~Task()
+    {
+        reset();
+    }
+
+    void operator()()
+    {
+        m_vtable->invoke(m_storage);
+    }
+
+    explicit operator bool() const
+    {
+        return m_vtable != nullptr;
+    }
+
+    void reset()
+    {
+        if (m_vtable) {
+            m_vtable->destroy(m_storage);
+            m_vtable = nullptr;
+        }
+    }
+
+    // True if a closure of this type is stored without a heap allocation
+    template <typename F>
+    static constexpr bool fits_inline()
+    {
+        return sizeof(F) <= INLINE_CAPACITY
+            && alignof(std::max_align_t) % alignof(F) == 0
+            && std::is_nothrow_move_constructible_v<F>;
+    }
+
+private:
+    struct VTable {
+        void (*invoke)(void*);
+        void (*move)(void* target, void* source) noexcept;
+        void (*destroy)(void*) noexcept;
+    };
+
+    template <typename F>
+    static constexpr VTable inline_vtable{
+        .invoke = [](void* storage) { (*static_cast<F*>(storage))(); },
+        .move = [](void* target, void* source) noexcept {
+            new (target) F(std::move(*static_cast<F*>(source)));
+            static_cast<F*>(source)->~F();
+        },
+        .destroy = [](void* storage) noexcept { static_cast<F*>(storage)->~F(); },
+    };
+
+    template <typename F>
+    static constexpr VTable heap_vtable{
+        .invoke = [](void* storage) { (**static_cast<F**>(storage))(); },
+        .move = [](void* target, void* source) noexcept { new (target) F*(*static_cast<F**>(source)); },
+        .destroy = [](void* storage) noexcept { delete *static_cast<F**>(storage); },
+    };
+
+    alignas(std::max_align_t) std::byte m_storage[INLINE_CAPACITY];
+    VTable const* m_vtable{nullptr};
+
+    void move_from(Task& other) noexcept
+    {
+        if (other.m_vtable) {
+            other.m_vtable->move(m_storage, other.m_storage);
+            m_vtable = other.m_vtable;
+            other.m_vtable = nullptr;
+        }
+    }
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core/AsyncTaskQueue.hpp"
+#include "core/Task.hpp"
+#include <initializer_list>
+#include <memory>
+
+/*
+ * Runs tasks as soon as all tasks they depend on finished, each one on its own queue.
+ * Multi-stage loaders are declared once instead of pushing the next stage from inside a task:
+ *
+ *     auto graph = TaskGraph{};
+ *     auto decode = graph.add(AsyncTaskQueue::background, [] { ... });
+ *     graph.add(AsyncTaskQueue::main, [] { ... }, {decode});
+ *     graph.submit();
+ *
+ * Running tasks may add more tasks and dependencies, e.g. to decode every texture of a model in parallel
+ * once the model is parsed. Copies of a `TaskGraph` refer to the same graph.
+ */
+class TaskGraph {
+public:
+    using NodeId = std::size_t;
+
+    explicit TaskGraph(AsyncTaskQueue::Priority = AsyncTaskQueue::Priority::VISIBLE_SOON);
+
+    // Tasks added after `submit` are started as soon as their dependencies finished
+    NodeId add(AsyncTaskQueue&, Task, std::initializer_list<NodeId> dependencies = {});
+    // `node` must not have started yet, so either the graph is not submitted or a task that `node`
+    // already depends on is still running (e.g. the task that calls this).
+    void add_dependency(NodeId node, NodeId dependency);
+    void submit();
+    // Running tasks finish, but no further tasks of the graph are started
+    void cancel();
+    // Raises the priority of all tasks that didn't start yet. Lowering the priority has no effect.
+    void set_priority(AsyncTaskQueue::Priority);
+    [[nodiscard]] AsyncTaskQueue::Priority priority() const;
+    [[nodiscard]] bool is_cancelled() const;
+    // True once every task ran
+    [[nodiscard]] bool is_finished() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> m_state;
+};
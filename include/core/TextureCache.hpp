@@ -0,0 +1,19 @@
+#pragma once
+
+#include "renderer/Texture.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+/*
+ * Stores block compressed mip chains of textures, so images only have to be decoded and compressed once.
+ * A cache file is only valid for the source path and modification time it was created with.
+ * Loaded images point directly into the mapped cache file.
+ */
+struct TextureCache {
+    static constexpr std::uint32_t VERSION = 1;
+
+    static std::filesystem::path cache_file(std::filesystem::path cache_directory, std::filesystem::path source);
+    static std::optional<CompressedImage> load(std::filesystem::path cache_file, std::filesystem::path source);
+    static bool store(std::filesystem::path cache_file, std::filesystem::path source, CompressedImage const&);
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "renderer/Texture.hpp"
+
+/*
+ * Encodes images into block compressed mip chains on the CPU, so they can be stored in the `TextureCache` and
+ * uploaded with `glCompressedTexImage2D` instead of being decoded and uploaded raw on every load.
+ * The encoder is a fast single pass one (principal axis + one least squares refinement for BC1), not an exhaustive search.
+ */
+struct TextureCompressor {
+    // Picks BC4 for single channel images, BC1 for RGB and opaque RGBA images and BC3 for RGBA images with alpha.
+    // Mip levels are made with `Image::downsample`, the blocks of large levels are encoded in parallel on the background queue.
+    static CompressedImage compress(Image const&);
+};
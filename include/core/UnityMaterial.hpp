@@ -0,0 +1,24 @@
+#pragma once
+
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// The properties of a Unity `.mat` file that are relevant for the editor
+struct UnityMaterial {
+    // Modification time of the file the material was parsed from
+    std::filesystem::file_time_type mtime;
+    // Property name (e.g. `_MainTex`) to texture guid, properties without a texture are left out
+    std::unordered_map<std::string, std::string> textures;
+    std::unordered_map<std::string, float> floats;
+    std::unordered_map<std::string, glm::vec4> colors;
+
+    // Only understands the text format with `serializedVersion: 3` properties
+    static std::optional<UnityMaterial> parse(std::filesystem::path const&, std::filesystem::file_time_type mtime);
+
+    [[nodiscard]] std::optional<std::string> texture_guid(std::string const& property) const;
+    [[nodiscard]] std::optional<std::string> base_texture_guid() const;
+    [[nodiscard]] std::optional<std::string> mask_texture_guid() const;
+};
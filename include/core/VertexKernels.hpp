@@ -0,0 +1,22 @@
+#pragma once
+
+#include "renderer/Vertex.hpp"
+#include <glm/glm.hpp>
+#include <span>
+
+/*
+ * Tight loops of the import path. On x86-64 they use SSE2, which every x86-64 CPU supports, so no runtime
+ * dispatch is needed. Other targets use the scalar versions, which are also used as the benchmark reference.
+ */
+struct VertexKernels {
+    // Interleaves separate attribute arrays with 3 floats per vertex (the layout of `aiVector3D`) into `vertices`.
+    // `normals` and `tex_coords` may be nullptr, missing attributes are zero. Only x and y of the texture coordinates are used.
+    static void interleave(std::span<Vertex> vertices, float const* positions, float const* normals, float const* tex_coords);
+    static void translate(std::span<Vertex> vertices, glm::vec3 offset);
+    // Returns an inverted AABB (min > max) if there are no vertices
+    static AABB compute_aabb(std::span<Vertex const> vertices);
+
+    static void interleave_scalar(std::span<Vertex> vertices, float const* positions, float const* normals, float const* tex_coords);
+    static void translate_scalar(std::span<Vertex> vertices, glm::vec3 offset);
+    static AABB compute_aabb_scalar(std::span<Vertex const> vertices);
+};
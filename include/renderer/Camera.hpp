@@ -76,4 +76,6 @@ private:
     unsigned int m_quad_vao{0}, m_quad_vbo{0};
 
     void draw_quad();
+    // Draws HLOD proxies instead of subtrees that are small on screen, if `may_use_proxy` is set
+    void draw_subtree(ViewingMode, Shader const&, glm::mat4 const& view_projection, int viewport_height, InstancedNode const&, bool may_use_proxy);
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <span>
+#include <vector>
+
+enum class IndexType : std::uint32_t {
+    UINT16,
+    UINT32,
+};
+
+std::size_t index_size(IndexType);
+GLenum gl_index_type(IndexType);
+
+// Index storage of a mesh. Most merged meshes have less than 65536 vertices and can use 16 bit indices,
+// which halves the index memory and bandwidth. The indices are kept as raw bytes in the format of the
+// GL element buffer, so they can be uploaded and cached without converting them.
+class IndexData {
+public:
+    IndexData() = default;
+    // Uses 16 bit indices if all `vertex_count` vertices can be addressed with them
+    IndexData(std::span<unsigned int const> indices, std::size_t vertex_count);
+    // Copies indices that are already in the given format
+    IndexData(std::span<std::byte const> bytes, IndexType);
+
+    [[nodiscard]] IndexType type() const;
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] unsigned int operator[](std::size_t) const;
+    [[nodiscard]] std::span<std::byte const> bytes() const;
+    [[nodiscard]] std::vector<unsigned int> to_vector() const;
+
+private:
+    IndexType m_type{IndexType::UINT32};
+    std::vector<std::byte> m_data;
+};
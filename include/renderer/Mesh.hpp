@@ -1,44 +1,122 @@
 #pragma once
 
+#include "renderer/IndexData.hpp"
 #include "renderer/Shader.hpp"
 #include "renderer/Texture.hpp"
+#include "renderer/Vertex.hpp"
 
+#include "core/MappedFile.hpp"
+#include <atomic>
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <memory>
+#include <span>
 #include <stb_image.h>
 #include <vector>
 
-struct Vertex {
-    glm::vec3 m_position;
-    glm::vec3 m_normal;
-    glm::vec2 m_tex_coords;
+// Half the size of `Vertex`. Positions are 16 bit fractions of the mesh AABB, normals are octahedral encoded
+// into two 16 bit fractions and texture coordinates are half floats. The shaders dequantize them.
+struct QuantizedVertex {
+    std::uint16_t m_position[3];
+    std::uint16_t m_padding;
+    std::uint16_t m_normal[2];
+    std::uint16_t m_tex_coords[2];
 };
 
-struct AABB {
-    glm::vec3 min;
-    glm::vec3 max;
+enum class VertexFormat : std::uint32_t {
+    FLOAT,
+    QUANTIZED,
+};
+
+// A range of the index buffer. LOD 0 is the full mesh, each further LOD has fewer triangles
+// that reuse the same vertices.
+struct MeshLod {
+    std::uint32_t index_offset;
+    std::uint32_t index_count;
+    float error; // Simplification error relative to the AABB diagonal
+};
+
+QuantizedVertex quantize_vertex(Vertex const&, AABB const&);
+Vertex dequantize_vertex(QuantizedVertex const&, AABB const&);
+
+// Geometry that lives in a mapped mesh cache file. The spans stay valid as long as `file` is alive.
+// Only one of the vertex spans is used, depending on the vertex format of the cache file.
+struct MappedGeometry {
+    std::span<Vertex const> vertices;
+    std::span<QuantizedVertex const> quantized_vertices;
+    std::span<std::byte const> indices;
+    IndexType index_type{IndexType::UINT32};
+    std::shared_ptr<MappedFile const> file;
+};
 
-    AABB merge(AABB const&);
+struct MeshGeometry {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
 };
 
 class Mesh {
 public:
     std::vector<Vertex> m_vertices;
-    std::vector<unsigned int> m_indices;
+    std::vector<QuantizedVertex> m_quantized_vertices;
+    // Picks 16 bit indices if the mesh has few enough vertices. Contains the indices of all LODs.
+    IndexData m_indices;
     Texture const* m_texture_diffuse;
     Texture const* m_texture_opacity;
     AABB aabb;
 
+    // Without `lods`, all indices are drawn as a single LOD
     Mesh(std::vector<Vertex> vertices,
         std::vector<unsigned int> indices,
         Texture const* texture_diffuse,
         Texture const* texture_opacity,
-        AABB);
+        AABB,
+        std::vector<MeshLod> lods = {});
+    // The AABB must be the one the vertices were quantized with
+    Mesh(std::vector<QuantizedVertex> vertices,
+        std::vector<unsigned int> indices,
+        Texture const* texture_diffuse,
+        Texture const* texture_opacity,
+        AABB,
+        std::vector<MeshLod> lods = {});
+    // The geometry is uploaded straight from the mapping, without copying it into `m_vertices` and `m_indices`
+    Mesh(MappedGeometry,
+        Texture const* texture_diffuse,
+        Texture const* texture_opacity,
+        AABB,
+        std::vector<MeshLod> lods = {});
 
-    void draw() const;
-    void draw(ViewingMode) const;
+    // Sets the dequantization uniforms of the given shader, which must be in use
+    void draw(Shader const&, std::size_t lod = 0) const;
+    void draw(ViewingMode, std::size_t lod = 0) const;
+    // Picks the coarsest LOD whose error stays below `pixel_error` pixels,
+    // if the AABB diagonal covers `projected_size` pixels on screen.
+    [[nodiscard]] std::size_t select_lod(float projected_size, float pixel_error) const;
+    [[nodiscard]] std::size_t lod_count() const;
     [[nodiscard]] bool is_fully_loaded() const;
-    void setup_mesh();
+    // Without `keep_cpu_data`, the vertices and indices are freed once they are on the GPU.
+    // Only the AABB and the element counts are kept, which is all that is needed for drawing.
+    void setup_mesh(bool keep_cpu_data = true);
+    [[nodiscard]] bool has_cpu_data() const;
+    // Deletes the GPU buffers. Meshes of models live as long as the project, only meshes that are replaced need this.
+    void release_buffers();
+    [[nodiscard]] VertexFormat vertex_format() const;
+    // Returns a copy of the geometry of LOD 0, quantized vertices are dequantized. If the CPU data was released,
+    // it is read back from the GPU, so this must be called on the main thread and should only be used sparingly.
+    [[nodiscard]] MeshGeometry read_geometry() const;
+    // Whether `read_geometry` has to read from the GPU. Otherwise it only reads the mapping or the CPU data,
+    // which can be done on any thread once the mesh is loaded.
+    [[nodiscard]] bool needs_readback() const;
+    // Total size of the CPU data that was released after uploading it
+    static std::size_t released_bytes();
 
 private:
+    static std::atomic<std::size_t> total_released_bytes;
+
     unsigned int m_vao{0}, m_vbo{0}, m_ebo{0};
+    VertexFormat m_vertex_format{VertexFormat::FLOAT};
+    IndexType m_index_type{IndexType::UINT32};
+    std::size_t m_vertex_count{0};
+    std::size_t m_index_count{0};
+    std::vector<MeshLod> m_lods;
+    MappedGeometry m_mapped_geometry;
 };
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct PixelBuffer {
+    unsigned int id;
+    std::size_t capacity;
+    std::byte* mapping{nullptr}; // While the buffer is mapped for writing
+    GLsync fence{nullptr}; // Set once uploads from the buffer were issued
+};
+
+/*
+ * Pixel buffer objects to stage texture uploads. The main thread maps a buffer, a worker fills it and the main
+ * thread uploads from it, so the driver transfers the pixels asynchronously instead of copying them from client
+ * memory on the main thread. Buffers are reused once a fence shows that the GPU finished reading them.
+ *
+ * All functions must be called on the main thread. The returned buffers may be filled and dropped on any thread.
+ */
+class PixelBufferPool {
+public:
+    PixelBufferPool() = default;
+    PixelBufferPool(PixelBufferPool const&) = delete;
+    PixelBufferPool& operator=(PixelBufferPool const&) = delete;
+    ~PixelBufferPool();
+
+    // Returns a buffer of at least `size` bytes that is mapped for writing, or nullptr if it couldn't be mapped
+    std::shared_ptr<PixelBuffer> acquire(std::size_t size);
+    // Unmaps the buffer and binds it to `GL_PIXEL_UNPACK_BUFFER`, texture uploads then read from offsets into it.
+    // Returns false if the driver discarded the contents, `finish_upload` must be called in either case.
+    bool bind_for_upload(PixelBuffer&);
+    // Unbinds the buffer after the uploads were issued
+    void finish_upload(PixelBuffer&);
+    // Reuses the buffers that were dropped and that the GPU finished reading, call once per frame
+    void collect();
+
+private:
+    void release(PixelBuffer const&);
+    void recycle(PixelBuffer const&);
+    static void destroy(PixelBuffer const&);
+
+    std::vector<PixelBuffer> m_free;
+    std::size_t m_free_size{0};
+    std::vector<PixelBuffer> m_in_flight;
+
+    std::mutex m_released_mutex;
+    std::vector<PixelBuffer> m_released;
+};
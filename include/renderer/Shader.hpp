@@ -52,6 +52,9 @@ struct UniformLocations {
     int model{-1};
     int view{-1};
     int projection{-1};
+    int position_offset{-1};
+    int position_scale{-1};
+    int octahedral_normals{-1};
 
     // Fragment
     int texture_diffuse{-1};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+ * Pools the memory of decoded images. stb_image allocates through it, so a decoded image is adopted by `ImageData`
+ * without a copy. Released buffers are kept in power of two size classes and reused by the next decode, so
+ * streaming textures doesn't allocate and free full-size buffers for every one of them.
+ */
+struct StagingAllocator {
+    struct Stats {
+        std::size_t allocations; // Served by the system allocator
+        std::size_t reuses; // Served from the pool
+        std::size_t used_bytes; // Held by live buffers
+        std::size_t pooled_bytes; // Held by the pool for reuse
+    };
+
+    // Thread-safe, same contract as malloc, realloc and free
+    static void* allocate(std::size_t size);
+    static void* reallocate(void* pointer, std::size_t size);
+    static void free(void* pointer);
+    static Stats stats();
+};
+
+// Pixels of an `Image`, allocated from the `StagingAllocator`
+class ImageData {
+public:
+    ImageData() = default;
+    explicit ImageData(std::size_t size);
+    // Takes ownership of memory from `StagingAllocator::allocate`
+    static ImageData adopt(unsigned char* data, std::size_t size);
+
+    ImageData(ImageData const&) = delete;
+    ImageData& operator=(ImageData const&) = delete;
+    ImageData(ImageData&&);
+    ImageData& operator=(ImageData&&);
+    ~ImageData();
+
+    [[nodiscard]] unsigned char* data() { return m_data; }
+    [[nodiscard]] unsigned char const* data() const { return m_data; }
+    [[nodiscard]] std::size_t size() const { return m_size; }
+    [[nodiscard]] bool empty() const { return m_size == 0; }
+    unsigned char& operator[](std::size_t i) { return m_data[i]; }
+    unsigned char const& operator[](std::size_t i) const { return m_data[i]; }
+
+private:
+    unsigned char* m_data{nullptr};
+    std::size_t m_size{0};
+};
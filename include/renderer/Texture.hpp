@@ -1,9 +1,14 @@
 #pragma once
 
+#include "renderer/StagingAllocator.hpp"
 #include <assimp/scene.h>
 #include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <memory>
 #include <optional>
+#include <span>
 #include <stb_image.h>
 #include <vector>
 
@@ -11,9 +16,48 @@ struct Image {
     int width;
     int height;
     int channels;
-    std::vector<unsigned char> data;
+    ImageData data;
+    // The smaller mip levels, largest first down to 1x1. If empty, the driver generates them on upload.
+    std::vector<Image> mips;
 
     static std::optional<Image> load_from_file(char const* path);
+
+    // Halves the size with a 2x2 box filter. The color channels of RGB(A) images are averaged in linear space,
+    // because they are uploaded as sRGB. Large images are filtered in parallel on the background queue.
+    [[nodiscard]] Image downsample() const;
+    // Fills `mips`, so the main thread only has to upload them
+    void generate_mips();
+    // Size of the pixels of all levels
+    [[nodiscard]] std::size_t byte_size() const;
+    // Copies the pixels of all levels back to back, largest first
+    void copy_to(std::byte* destination) const;
+};
+
+// Block compressed formats, every 4x4 block of pixels is stored in 8 (BC1, BC4) or 16 (BC3) bytes
+enum class CompressedFormat : std::uint8_t {
+    BC1_SRGB, // RGB
+    BC3_SRGB, // RGBA
+    BC4, // Single channel
+};
+
+struct CompressedMip {
+    int width;
+    int height;
+    std::size_t offset; // Into `CompressedImage::data`
+    std::size_t size;
+};
+
+// A block compressed image with its whole mip chain, created by `TextureCompressor` or loaded from the `TextureCache`
+struct CompressedImage {
+    int width;
+    int height;
+    int channels; // Of the source image
+    CompressedFormat format;
+    std::vector<CompressedMip> mips; // Largest first, down to 1x1
+    std::span<std::byte const> data;
+    std::shared_ptr<void const> storage; // Owns `data`, either a buffer or the mapped cache file
+
+    static std::size_t block_size(CompressedFormat);
 };
 
 struct ColorTexture;
@@ -24,8 +68,19 @@ struct Texture {
     int height;
     int channels;
     bool is_loaded{false};
+    // Estimated VRAM use including the mips, 0 for placeholders
+    std::size_t memory_size{0};
+    // `Project::frame` in which the texture was last drawn or requested, the least recently used ones are unloaded first
+    mutable std::uint64_t last_used_frame{0};
 
     static std::optional<Texture> load_from_image(Image);
+    static std::optional<Texture> load_from_compressed(CompressedImage const&);
+    // Upload from the pixel buffer that is bound to `GL_PIXEL_UNPACK_BUFFER` and holds the data of the image,
+    // copied with `Image::copy_to` or at the offsets of the compressed mips. The pixels in RAM aren't read.
+    static std::optional<Texture> load_from_pixel_buffer(Image const&);
+    static std::optional<Texture> load_from_pixel_buffer(CompressedImage const&);
+    // Whether the driver accepts the formats of `CompressedImage`, needs a current OpenGL context
+    static bool supports_compression();
     static Texture fallback_placeholder(unsigned int id);
     static ColorTexture single_color(glm::vec4 color);
 
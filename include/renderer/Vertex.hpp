@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Kept apart from `Mesh`, so the import kernels and their benchmark don't depend on GL
+struct Vertex {
+    glm::vec3 m_position;
+    glm::vec3 m_normal;
+    glm::vec2 m_tex_coords;
+};
+
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    AABB merge(AABB const&);
+    // Bounds of the transformed box, which are larger than the transformed mesh for rotations
+    [[nodiscard]] AABB transformed(glm::mat4 const&) const;
+};
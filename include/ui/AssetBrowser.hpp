@@ -24,6 +24,8 @@ private:
     Camera m_model_preview_camera{glm::vec3{}, glm::vec3{}};
     Uniforms m_model_preview_uniforms;
     unsigned int m_preview_texture;
+    // Project textures may be evicted and loaded again, so their id is read every frame
+    Texture const* m_preview_image{nullptr};
     std::string m_preview_name;
     bool m_preview_dirty{true};
 
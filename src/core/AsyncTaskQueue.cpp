@@ -1,22 +1,162 @@
 #include "core/AsyncTaskQueue.hpp"
 
-#include <optional>
+#include <algorithm>
 
 AsyncTaskQueue AsyncTaskQueue::background;
 AsyncTaskQueue AsyncTaskQueue::main;
 std::vector<std::thread> AsyncTaskQueue::threadpool;
 
-void AsyncTaskQueue::init()
-{
-    auto const thread_count = 4;
+// Identifies the queue and worker deque that belong to the current thread.
+// Only set on threads that were spawned by `start_workers`.
+static thread_local AsyncTaskQueue* current_queue{nullptr};
+static thread_local std::size_t current_worker_index{0};
+
+// Recycles task nodes. Every thread keeps a small cache of free nodes, so the shared free list
+// and its lock are only touched once per `LOCAL_CACHE_SIZE` allocations.
+class TaskNodePool {
+public:
+    using TaskNode = AsyncTaskQueue::TaskNode;
+
+    static TaskNode* acquire()
+    {
+        auto& cache = local_cache();
+        if (!cache.head) {
+            get().refill(cache);
+        }
+
+        auto* node = cache.head;
+        cache.head = node->next_free;
+        --cache.size;
+
+        // The node is not shared yet, it is published by the lock that guards the queue it is pushed onto
+        node->next_free = nullptr;
+        node->claimed.store(false, std::memory_order_relaxed);
+        node->cancelled.store(false, std::memory_order_relaxed);
+        return node;
+    }
+
+    static void release(TaskNode* node)
+    {
+        node->function.reset();
+
+        auto& cache = local_cache();
+        node->next_free = cache.head;
+        cache.head = node;
+        ++cache.size;
+
+        if (cache.is_disabled) {
+            get().drain(cache, cache.size);
+        } else if (cache.size >= 2 * LOCAL_CACHE_SIZE) {
+            get().drain(cache, LOCAL_CACHE_SIZE);
+        }
+    }
+
+private:
+    static constexpr std::size_t LOCAL_CACHE_SIZE = 64;
+    static constexpr std::size_t BLOCK_SIZE = 256;
+
+    // Trivially destructible, so it can still be used by static destructors that run after the thread exited
+    struct LocalCache {
+        TaskNode* head{nullptr};
+        std::size_t size{0};
+        bool is_disabled{false};
+    };
+
+    // Returns the cached nodes of a thread to the shared free list once the thread exits
+    struct LocalCacheGuard {
+        LocalCache& cache;
+
+        ~LocalCacheGuard()
+        {
+            get().drain(cache, cache.size);
+            cache.is_disabled = true;
+        }
+    };
 
-    for (std::size_t i = 0; i < thread_count; ++i) {
-        threadpool.emplace_back([]() {
-            while (background.is_open()) {
-                background.run_blocking();
+    std::mutex m_mutex;
+    TaskNode* m_free_list{nullptr};
+    std::vector<std::unique_ptr<TaskNode[]>> m_blocks;
+
+    static TaskNodePool& get()
+    {
+        // Intentionally never destroyed, nodes might still be released by other static destructors
+        static auto* pool = new TaskNodePool{};
+        return *pool;
+    }
+
+    static LocalCache& local_cache()
+    {
+        thread_local LocalCache cache;
+        if (!cache.is_disabled) {
+            thread_local LocalCacheGuard guard{cache};
+        }
+        return cache;
+    }
+
+    void refill(LocalCache& cache)
+    {
+        auto lock = std::lock_guard<std::mutex>{m_mutex};
+
+        if (!m_free_list) {
+            auto& block = m_blocks.emplace_back(std::make_unique<TaskNode[]>(BLOCK_SIZE));
+            for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+                block[i].next_free = m_free_list;
+                m_free_list = &block[i];
             }
-        });
+        }
+
+        auto const target_size = cache.is_disabled ? 1 : LOCAL_CACHE_SIZE;
+        while (m_free_list && cache.size < target_size) {
+            auto* node = m_free_list;
+            m_free_list = node->next_free;
+            node->next_free = cache.head;
+            cache.head = node;
+            ++cache.size;
+        }
     }
+
+    void drain(LocalCache& cache, std::size_t count)
+    {
+        auto lock = std::lock_guard<std::mutex>{m_mutex};
+
+        for (; count > 0 && cache.head; --count) {
+            auto* node = cache.head;
+            cache.head = node->next_free;
+            --cache.size;
+            node->next_free = m_free_list;
+            m_free_list = node;
+        }
+    }
+};
+
+void retain(AsyncTaskQueue::TaskNode* node)
+{
+    node->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+void release(AsyncTaskQueue::TaskNode* node)
+{
+    // The last owner doesn't need the atomic decrement, nobody else can add a reference anymore
+    if (node->references.load(std::memory_order_acquire) == 1
+        || node->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        TaskNodePool::release(node);
+    }
+}
+
+// Only lock holders write the task totals, so they don't need an atomic increment
+void increment_total(std::atomic<std::size_t>& total)
+{
+    total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void AsyncTaskQueue::init()
+{
+    // Leave one hardware thread for the main thread, which renders and uploads to the GPU.
+    // `hardware_concurrency` may return 0 if the value is not computable.
+    auto const hardware_threads = std::thread::hardware_concurrency();
+    auto const thread_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+
+    background.start_workers(thread_count);
 }
 
 void AsyncTaskQueue::shutdown()
@@ -28,67 +168,320 @@ void AsyncTaskQueue::shutdown()
     }
 }
 
+AsyncTaskQueue::~AsyncTaskQueue()
+{
+    auto release_all = [](PriorityQueues& queues) {
+        for (auto& entries : queues) {
+            for (auto* node : entries) {
+                release(node);
+            }
+            entries.clear();
+        }
+    };
+
+    // Tasks that never ran are destroyed without running them
+    release_all(m_queue);
+    for (auto& worker : m_workers) {
+        release_all(worker->tasks);
+    }
+}
+
+void AsyncTaskQueue::start_workers(std::size_t count)
+{
+    // All deques must exist before the first thread starts stealing from them
+    for (std::size_t i = 0; i < count; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        threadpool.emplace_back([this, i]() {
+            run_worker(i);
+        });
+    }
+}
+
+void AsyncTaskQueue::run_worker(std::size_t index)
+{
+    current_queue = this;
+    current_worker_index = index;
+
+    while (is_open()) {
+        run_blocking();
+    }
+}
+
 void AsyncTaskQueue::run()
 {
-    while (true) {
-        std::optional<std::function<void()>> task;
+    auto const worker_index = current_queue == this
+        ? std::optional{current_worker_index}
+        : std::nullopt;
 
-        {
-            auto lock = std::lock_guard<std::mutex>{m_queue_mutex};
+    while (m_is_open) {
+        auto* node = pop_task(worker_index);
+        if (!node) {
+            return;
+        }
 
-            if (!m_is_open || m_queue.empty()) {
-                return;
-            }
+        run_task(node);
+    }
+}
+
+AsyncTaskQueue::RunResult AsyncTaskQueue::run_for(std::chrono::microseconds budget)
+{
+    auto const worker_index = current_queue == this
+        ? std::optional{current_worker_index}
+        : std::nullopt;
+
+    auto const deadline = std::chrono::steady_clock::now() + budget;
+    auto result = RunResult{};
 
-            task = std::move(m_queue.front());
-            m_queue.pop();
+    while (m_is_open) {
+        if (result.tasks_run > 0 && std::chrono::steady_clock::now() >= deadline) {
+            break;
         }
 
-        if (task.has_value()) {
-            task.value()();
+        auto* node = pop_task(worker_index);
+        if (!node) {
+            break;
         }
+
+        run_task(node);
+        ++result.tasks_run;
     }
+
+    result.tasks_left = m_num_queued_tasks;
+    result.time_left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+    m_last_run_result = result;
+
+    return result;
 }
 
 void AsyncTaskQueue::run_blocking()
 {
-    while (true) {
-        std::optional<std::function<void()>> task;
+    auto const worker_index = current_queue == this
+        ? std::optional{current_worker_index}
+        : std::nullopt;
 
-        {
-            auto lock = std::unique_lock<std::mutex>{m_queue_mutex};
-            m_convar.wait(lock, [&]() { return !m_queue.empty() || !m_is_open; });
+    while (m_is_open) {
+        if (auto* node = pop_task(worker_index)) {
+            run_task(node);
+            continue;
+        }
 
-            if (!m_is_open) {
-                return;
-            }
+        wait_for_tasks();
+    }
+}
 
-            if (!m_queue.empty()) {
-                task = std::move(m_queue.front());
-                m_queue.pop();
-            }
+void AsyncTaskQueue::wait_for_tasks()
+{
+    auto lock = std::unique_lock<std::mutex>{m_sleep_mutex};
+    ++m_num_sleeping_threads;
+    m_convar.wait(lock, [&]() { return m_num_queued_tasks > 0 || !m_is_open; });
+    --m_num_sleeping_threads;
+}
+
+void AsyncTaskQueue::parallel_for(std::size_t count, std::function<void(std::size_t)> const& function, Priority priority)
+{
+    // A few tasks per worker that claim indices one by one, so uneven calls are balanced
+    // without queueing a task for every index
+    auto const tasks_per_worker = std::size_t{4};
+    auto const task_count = std::min(count, m_workers.size() * tasks_per_worker);
+
+    std::atomic<std::size_t> next_index{0};
+    // Shared with the tasks, the last one notifies the caller, which may return right after the decrement
+    auto running_tasks = std::make_shared<std::atomic<std::size_t>>(task_count);
+
+    auto run_indices = [&]() {
+        for (auto index = next_index++; index < count; index = next_index++) {
+            function(index);
         }
+    };
 
-        if (task.has_value()) {
-            task.value()();
+    auto run_task = [&run_indices, running_tasks]() {
+        run_indices();
+        if (running_tasks->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            running_tasks->notify_all();
         }
+    };
+
+    std::vector<TaskHandle> handles;
+    handles.reserve(task_count);
+    for (std::size_t i = 0; i < task_count; ++i) {
+        handles.push_back(push_task(run_task, priority));
+    }
+
+    // The calling thread only works on its own indices. It never picks up unrelated tasks,
+    // so e.g. the main thread doesn't end up running a whole model import.
+    run_indices();
+
+    // Tasks that didn't start yet are not needed anymore, the others are finishing their last index
+    for (auto& handle : handles) {
+        if (handle.cancel()) {
+            running_tasks->fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Block instead of spinning, a nested loop on a worker may wait for a sibling that works on a large index
+    for (auto running = running_tasks->load(std::memory_order_acquire); running > 0; running = running_tasks->load(std::memory_order_acquire)) {
+        running_tasks->wait(running, std::memory_order_acquire);
     }
 }
 
-void AsyncTaskQueue::push_task(std::function<void()> task)
+AsyncTaskQueue::TaskHandle AsyncTaskQueue::push_task(Task task, Priority priority)
 {
-    {
+    auto* node = TaskNodePool::acquire();
+    node->function = std::move(task);
+    node->priority.store(priority, std::memory_order_relaxed);
+    // One reference for the queue entry and one for the returned handle
+    node->references.store(2, std::memory_order_relaxed);
+
+    push_entry(node, priority, true);
+
+    return TaskHandle{this, node};
+}
+
+void AsyncTaskQueue::push_entry(Entry entry, Priority priority, bool is_new_task)
+{
+    auto const priority_index = static_cast<std::size_t>(priority);
+
+    // Counted before the entry is published, so a concurrent pop never decrements below zero
+    if (m_workers.empty()) {
         auto lock = std::lock_guard<std::mutex>{m_queue_mutex};
-        m_queue.push(std::move(task));
-        ++m_total_queued_tasks;
+        ++m_num_queued_tasks;
+        m_queue[priority_index].push_back(entry);
+        if (is_new_task) {
+            increment_total(m_queue_total_tasks);
+        }
+    } else {
+        // Workers push onto their own deque. Other threads spread their tasks round-robin,
+        // so external submissions never contend on a single lock.
+        auto const index = current_queue == this
+            ? current_worker_index
+            : m_next_worker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+
+        auto& worker = *m_workers[index];
+        auto lock = std::lock_guard<std::mutex>{worker.mutex};
+        ++m_num_queued_tasks;
+        worker.tasks[priority_index].push_back(entry);
+        if (is_new_task) {
+            increment_total(worker.total_tasks);
+        }
+    }
+
+    wake_one();
+}
+
+void AsyncTaskQueue::wake_one()
+{
+    // `m_num_queued_tasks` is incremented before `m_num_sleeping_threads` is read and a sleeping thread
+    // increments `m_num_sleeping_threads` before checking `m_num_queued_tasks`. Both are sequentially
+    // consistent, so at least one side always sees the other and no wakeup is lost.
+    if (m_num_sleeping_threads == 0) {
+        return;
     }
 
+    {
+        auto lock = std::lock_guard<std::mutex>{m_sleep_mutex};
+    }
     m_convar.notify_one();
 }
 
+AsyncTaskQueue::TaskNode* AsyncTaskQueue::pop_task(std::optional<std::size_t> worker_index)
+{
+    while (auto* node = pop_entry(worker_index)) {
+        // Skip cancelled tasks and stale entries of requeued tasks
+        if (node->claimed.exchange(true, std::memory_order_acq_rel)) {
+            release(node);
+            continue;
+        }
+
+        return node;
+    }
+
+    return nullptr;
+}
+
+void AsyncTaskQueue::run_task(TaskNode* node)
+{
+    node->function();
+    // Destroy the captures right away instead of whenever the last handle goes away
+    node->function.reset();
+    release(node);
+}
+
+AsyncTaskQueue::Entry AsyncTaskQueue::pop_entry(std::optional<std::size_t> worker_index)
+{
+    if (m_num_queued_tasks == 0) {
+        return nullptr;
+    }
+
+    // Queues without workers only have to look at one set of deques, so take its lock only once
+    if (m_workers.empty()) {
+        auto lock = std::lock_guard<std::mutex>{m_queue_mutex};
+        for (auto& tasks : m_queue) {
+            if (!tasks.empty()) {
+                auto entry = tasks.front();
+                tasks.pop_front();
+                --m_num_queued_tasks;
+                return entry;
+            }
+        }
+
+        return nullptr;
+    }
+
+    for (std::size_t priority = 0; priority < PRIORITY_COUNT; ++priority) {
+        Entry entry{nullptr};
+
+        if (worker_index.has_value()) {
+            auto& worker = *m_workers[worker_index.value()];
+            auto lock = std::lock_guard<std::mutex>{worker.mutex};
+            auto& tasks = worker.tasks[priority];
+            if (!tasks.empty()) {
+                entry = tasks.back();
+                tasks.pop_back();
+            }
+        }
+
+        if (!entry) {
+            entry = steal_entry(worker_index.has_value() ? worker_index.value() + 1 : 0, priority);
+        }
+
+        if (entry) {
+            --m_num_queued_tasks;
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+AsyncTaskQueue::Entry AsyncTaskQueue::steal_entry(std::size_t first_victim, std::size_t priority)
+{
+    for (std::size_t i = 0; i < m_workers.size(); ++i) {
+        auto& victim = *m_workers[(first_victim + i) % m_workers.size()];
+
+        // Don't wait for a busy deque, there are likely other tasks to steal
+        auto lock = std::unique_lock<std::mutex>{victim.mutex, std::try_to_lock};
+        if (!lock.owns_lock() || victim.tasks[priority].empty()) {
+            continue;
+        }
+
+        auto entry = victim.tasks[priority].front();
+        victim.tasks[priority].pop_front();
+        return entry;
+    }
+
+    return nullptr;
+}
+
 void AsyncTaskQueue::close()
 {
     m_is_open = false;
+
+    {
+        auto lock = std::lock_guard<std::mutex>{m_sleep_mutex};
+    }
     m_convar.notify_all();
 }
 
@@ -99,12 +492,132 @@ bool AsyncTaskQueue::is_open()
 
 std::size_t AsyncTaskQueue::num_queued_tasks()
 {
-    auto lock = std::lock_guard<std::mutex>{m_queue_mutex};
-    return m_queue.size();
+    return m_num_queued_tasks;
 }
 
 std::size_t AsyncTaskQueue::num_total_queued_tasks()
 {
-    auto lock = std::lock_guard<std::mutex>{m_queue_mutex};
-    return m_total_queued_tasks;
+    auto total = m_queue_total_tasks.load(std::memory_order_relaxed);
+    for (auto const& worker : m_workers) {
+        total += worker->total_tasks.load(std::memory_order_relaxed);
+    }
+
+    return total;
+}
+
+std::size_t AsyncTaskQueue::num_workers() const
+{
+    return m_workers.size();
+}
+
+AsyncTaskQueue::RunResult AsyncTaskQueue::last_run_result() const
+{
+    return m_last_run_result;
+}
+
+AsyncTaskQueue::TaskHandle::TaskHandle(AsyncTaskQueue* queue, TaskNode* node)
+    : m_queue{queue}
+    , m_node{node}
+{ }
+
+AsyncTaskQueue::TaskHandle::TaskHandle(TaskHandle const& other)
+    : m_queue{other.m_queue}
+    , m_node{other.m_node}
+{
+    if (m_node) {
+        retain(m_node);
+    }
+}
+
+AsyncTaskQueue::TaskHandle::TaskHandle(TaskHandle&& other)
+    : m_queue{other.m_queue}
+    , m_node{other.m_node}
+{
+    other.m_node = nullptr;
+}
+
+AsyncTaskQueue::TaskHandle& AsyncTaskQueue::TaskHandle::operator=(TaskHandle const& other)
+{
+    if (this != &other) {
+        if (other.m_node) {
+            retain(other.m_node);
+        }
+        if (m_node) {
+            release(m_node);
+        }
+        m_queue = other.m_queue;
+        m_node = other.m_node;
+    }
+
+    return *this;
+}
+
+AsyncTaskQueue::TaskHandle& AsyncTaskQueue::TaskHandle::operator=(TaskHandle&& other)
+{
+    if (this != &other) {
+        if (m_node) {
+            release(m_node);
+        }
+        m_queue = other.m_queue;
+        m_node = other.m_node;
+        other.m_node = nullptr;
+    }
+
+    return *this;
+}
+
+AsyncTaskQueue::TaskHandle::~TaskHandle()
+{
+    if (m_node) {
+        release(m_node);
+    }
+}
+
+bool AsyncTaskQueue::TaskHandle::cancel()
+{
+    if (!m_node || m_node->claimed.exchange(true)) {
+        return false;
+    }
+
+    // The task was claimed by this thread, so nobody else accesses the function anymore.
+    // Queued entries are dropped once they are popped.
+    m_node->cancelled = true;
+    m_node->function.reset();
+    return true;
+}
+
+void AsyncTaskQueue::TaskHandle::set_priority(Priority priority)
+{
+    if (!m_node || m_node->claimed) {
+        return;
+    }
+
+    auto current = m_node->priority.load();
+    while (priority < current) {
+        if (m_node->priority.compare_exchange_weak(current, priority)) {
+            retain(m_node);
+            m_queue->push_entry(m_node, priority, false);
+            return;
+        }
+    }
+}
+
+AsyncTaskQueue::Priority AsyncTaskQueue::TaskHandle::priority() const
+{
+    return m_node ? m_node->priority.load() : Priority::PREFETCH;
+}
+
+bool AsyncTaskQueue::TaskHandle::is_valid() const
+{
+    return m_node != nullptr;
+}
+
+bool AsyncTaskQueue::TaskHandle::is_cancelled() const
+{
+    return m_node && m_node->cancelled;
+}
+
+bool AsyncTaskQueue::TaskHandle::is_claimed() const
+{
+    return m_node && m_node->claimed;
 }
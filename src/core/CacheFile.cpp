@@ -0,0 +1,25 @@
+#include "core/CacheFile.hpp"
+
+#include <fstream>
+
+std::int64_t CacheFile::source_mtime(std::filesystem::path const& source)
+{
+    return std::filesystem::last_write_time(source).time_since_epoch().count();
+}
+
+bool CacheFile::write(std::filesystem::path const& cache_file, std::span<std::byte const> data)
+{
+    std::filesystem::create_directories(cache_file.parent_path());
+
+    auto temporary_file = cache_file;
+    temporary_file += ".tmp";
+    {
+        auto stream = std::ofstream{temporary_file, std::ios::binary | std::ios::trunc};
+        if (!stream.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()))) {
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary_file, cache_file);
+
+    return true;
+}
@@ -0,0 +1,177 @@
+#include "core/HlodBuilder.hpp"
+
+#include "core/MeshOptimizer.hpp"
+#include "core/VertexKernels.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+
+HlodProxy::HlodProxy(Texture atlas, HlodGeometry geometry, Texture const* texture_opacity, std::size_t subtree_hash)
+    : atlas(std::move(atlas))
+    , mesh(std::move(geometry.vertices), std::move(geometry.indices), &this->atlas, texture_opacity, geometry.aabb)
+    , subtree_hash(subtree_hash)
+{ }
+
+HlodProxy::~HlodProxy()
+{
+    mesh.release_buffers();
+}
+
+// The smallest mip level is the average color of the whole texture
+std::array<std::uint8_t, 4> average_color(Texture const& texture)
+{
+    auto const size = static_cast<unsigned int>(std::max({texture.width, texture.height, 1}));
+    auto const level = static_cast<GLint>(std::bit_width(size) - 1);
+
+    auto color = std::array<std::uint8_t, 4>{255, 255, 255, 255};
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, color.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Single channel textures are gray scale
+    if (texture.channels == 1) {
+        color[1] = color[2] = color[0];
+    }
+
+    return color;
+}
+
+// Each texture gets one texel. `Texture::load_from_image` uploads with an unpack alignment of 1, so rows need no padding.
+std::size_t atlas_side(std::size_t cell_count)
+{
+    auto side = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(cell_count))));
+    return std::max<std::size_t>(side, 1);
+}
+
+glm::vec2 cell_center(std::size_t cell, std::size_t side)
+{
+    return glm::vec2{
+        (static_cast<float>(cell % side) + 0.5f) / static_cast<float>(side),
+        (static_cast<float>(cell / side) + 0.5f) / static_cast<float>(side),
+    };
+}
+
+HlodSource HlodBuilder::collect(InstancedNode const& root)
+{
+    // Count the textures first, the texture coordinates depend on the size of the atlas
+    std::unordered_map<Texture const*, std::size_t> cells;
+    root.traverse([&](glm::mat4, Node const& node) {
+        for (auto const& mesh : node.meshes) {
+            cells.try_emplace(mesh.m_texture_diffuse, cells.size());
+        }
+    });
+
+    auto const side = atlas_side(cells.size());
+    auto source = HlodSource{
+        .meshes = {},
+        .textures = std::vector<Texture const*>(cells.size()),
+        .cell_colors = std::vector<std::uint8_t>(side * side * 3, 255),
+    };
+
+    for (auto const& [texture, cell] : cells) {
+        source.textures[cell] = texture;
+    }
+
+    auto const to_root = glm::inverse(root.model_matrix);
+    root.traverse([&](glm::mat4 model_matrix, Node const& node) {
+        for (auto const& mesh : node.meshes) {
+            source.meshes.push_back(HlodSourceMesh{
+                .mesh = &mesh,
+                .matrix = to_root * model_matrix,
+                .tex_coords = cell_center(cells.at(mesh.m_texture_diffuse), side),
+                .geometry = {},
+            });
+        }
+    });
+
+    return source;
+}
+
+void HlodBuilder::read_geometry(HlodSourceMesh& source_mesh)
+{
+    source_mesh.geometry = source_mesh.mesh->read_geometry();
+}
+
+void HlodBuilder::read_color(HlodSource& source, std::size_t cell)
+{
+    auto const color = average_color(*source.textures.at(cell));
+    std::copy_n(color.begin(), 3, source.cell_colors.begin() + static_cast<std::ptrdiff_t>(cell * 3));
+}
+
+HlodGeometry HlodBuilder::build(HlodSource source, float target_error)
+{
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    for (auto& source_mesh : source.meshes) {
+        auto const& matrix = source_mesh.matrix;
+        auto const normal_matrix = glm::transpose(glm::inverse(glm::mat3{matrix}));
+        auto const first_vertex = static_cast<unsigned int>(vertices.size());
+
+        for (auto const& vertex : source_mesh.geometry.vertices) {
+            vertices.push_back(Vertex{
+                .m_position = glm::vec3{matrix * glm::vec4{vertex.m_position, 1.0f}},
+                .m_normal = glm::normalize(normal_matrix * vertex.m_normal),
+                .m_tex_coords = source_mesh.tex_coords,
+            });
+        }
+
+        for (auto index : source_mesh.geometry.indices) {
+            indices.push_back(first_vertex + index);
+        }
+
+        source_mesh.geometry = {};
+    }
+
+    auto const triangle_count = indices.size() / 3;
+
+    // The UV seams of the meshes are gone now that every mesh has a single texel
+    MeshOptimizer::weld_vertices(vertices, indices, WeldTolerance{});
+
+    if (!vertices.empty()) {
+        auto const aabb = VertexKernels::compute_aabb(vertices);
+        MeshOptimizer::simplify(vertices, indices, 0, target_error * glm::length(aabb.max - aabb.min));
+    }
+
+    MeshOptimizer::optimize_vertex_cache(indices, vertices.size());
+    MeshOptimizer::optimize_vertex_fetch(vertices, indices);
+
+    std::cout << "Built HLOD proxy with " << indices.size() / 3 << " of " << triangle_count << " triangles\n";
+
+    auto const side = static_cast<int>(std::sqrt(static_cast<double>(source.cell_colors.size() / 3)));
+    auto const aabb = VertexKernels::compute_aabb(vertices);
+    auto atlas = ImageData{source.cell_colors.size()};
+    std::copy(source.cell_colors.begin(), source.cell_colors.end(), atlas.data());
+    return HlodGeometry{
+        .vertices = std::move(vertices),
+        .indices = std::move(indices),
+        .atlas = Image{
+            .width = side,
+            .height = side,
+            .channels = 3,
+            .data = std::move(atlas),
+            .mips = {},
+        },
+        .aabb = aabb,
+    };
+}
+
+std::unique_ptr<HlodProxy> HlodBuilder::create_proxy(HlodGeometry geometry, Texture const* texture_opacity, std::size_t subtree_hash)
+{
+    auto atlas = Texture::load_from_image(std::move(geometry.atlas));
+    if (!atlas.has_value()) {
+        return nullptr;
+    }
+
+    // Every triangle samples the center of a single texel, filtering would blend in the neighbouring cells
+    glBindTexture(GL_TEXTURE_2D, atlas->id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    auto proxy = std::make_unique<HlodProxy>(std::move(atlas.value()), std::move(geometry), texture_opacity, subtree_hash);
+    proxy->mesh.setup_mesh(false);
+    return proxy;
+}
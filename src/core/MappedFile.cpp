@@ -0,0 +1,142 @@
+#include "core/MappedFile.hpp"
+
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#    define NOMINMAX
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#ifdef _WIN32
+std::optional<MappedFile> MappedFile::open(std::filesystem::path path)
+{
+    auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open " << path << " for mapping\n";
+        return {};
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return {};
+    }
+
+    auto mapped_file = MappedFile{};
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return mapped_file;
+    }
+
+    // The mapping keeps the file open, so the file handle can be closed right away
+    auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        std::cerr << "Failed to map " << path << "\n";
+        return {};
+    }
+
+    auto* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        std::cerr << "Failed to map " << path << "\n";
+        CloseHandle(mapping);
+        return {};
+    }
+
+    mapped_file.m_data = static_cast<std::byte const*>(view);
+    mapped_file.m_size = static_cast<std::size_t>(size.QuadPart);
+    mapped_file.m_mapping = mapping;
+    return mapped_file;
+}
+
+void MappedFile::unmap()
+{
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+}
+#else
+std::optional<MappedFile> MappedFile::open(std::filesystem::path path)
+{
+    auto file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        std::cerr << "Failed to open " << path << " for mapping\n";
+        return {};
+    }
+
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0) {
+        close(file);
+        return {};
+    }
+
+    auto mapped_file = MappedFile{};
+    if (file_stat.st_size == 0) {
+        close(file);
+        return mapped_file;
+    }
+
+    // The mapping stays valid after closing the file descriptor
+    auto* data = mmap(nullptr, static_cast<std::size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to map " << path << "\n";
+        return {};
+    }
+
+    mapped_file.m_data = static_cast<std::byte const*>(data);
+    mapped_file.m_size = static_cast<std::size_t>(file_stat.st_size);
+    return mapped_file;
+}
+
+void MappedFile::unmap()
+{
+    if (m_data) {
+        munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+}
+#endif
+
+MappedFile::MappedFile(MappedFile&& other)
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+    if (this != &other) {
+        unmap();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+    }
+
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+std::span<std::byte const> MappedFile::data() const
+{
+    return {m_data, m_size};
+}
@@ -0,0 +1,229 @@
+#include "core/MeshCache.hpp"
+
+#include "core/CacheFile.hpp"
+#include "core/MappedFile.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <vector>
+
+/*
+ * File layout, all values in native byte order:
+ *
+ *   header: magic, version, import flags, vertex format, weld vertices, weld tolerance, optimize meshes,
+ *           generate LODs, source mtime, source path
+ *   node:   name, node path, transform, mesh count, meshes, child count, children (depth first)
+ *   mesh:   diffuse path, opacity path, unresolved diffuse name, AABB, LOD count, LODs, vertex count, index count, index type, vertices, indices
+ *
+ * Vertices are either `Vertex` or `QuantizedVertex`, depending on the vertex format.
+ * Indices are 16 or 32 bit, depending on the index type of the mesh.
+ *
+ * Strings are stored as length + characters, optional paths with a leading flag byte.
+ * Vertex and index arrays start at offsets that are a multiple of `ARRAY_ALIGNMENT`.
+ */
+
+constexpr char MAGIC[4] = {'3', 'D', 'M', 'C'};
+
+void write_transform(CacheWriter& writer, Transform const& transform)
+{
+    writer.write(transform.position);
+    writer.write(transform.orientation);
+    writer.write(transform.scale);
+}
+
+bool read_transform(CacheReader& reader, Transform& transform)
+{
+    return reader.read(transform.position)
+        && reader.read(transform.orientation)
+        && reader.read(transform.scale);
+}
+
+void write_node(CacheWriter& writer, ImportedNode const& node)
+{
+    writer.write_string(node.name);
+    writer.write_string(node.location.node_path.generic_string());
+    write_transform(writer, node.transform);
+
+    writer.write(static_cast<std::uint32_t>(node.meshes.size()));
+    for (auto const& mesh : node.meshes) {
+        writer.write_path(mesh.texture_diffuse);
+        writer.write_path(mesh.texture_opacity);
+        writer.write_string(mesh.unresolved_texture_diffuse);
+        writer.write(mesh.aabb);
+        writer.write(static_cast<std::uint32_t>(mesh.lods.size()));
+        for (auto const& lod : mesh.lods) {
+            writer.write(lod);
+        }
+        auto const vertex_count = mesh.vertices.size() + mesh.quantized_vertices.size();
+        auto const indices = IndexData{mesh.indices, vertex_count};
+        writer.write(static_cast<std::uint32_t>(vertex_count));
+        writer.write(static_cast<std::uint32_t>(indices.size()));
+        writer.write(indices.type());
+        if (mesh.quantized_vertices.empty()) {
+            writer.write_array(mesh.vertices);
+        } else {
+            writer.write_array(mesh.quantized_vertices);
+        }
+        writer.write_bytes(indices.bytes());
+    }
+
+    writer.write(static_cast<std::uint32_t>(node.children.size()));
+    for (auto const& child : node.children) {
+        write_node(writer, child);
+    }
+}
+
+std::optional<ImportedNode> read_node(CacheReader& reader, std::filesystem::path const& source, VertexFormat vertex_format, std::shared_ptr<MappedFile const> const& file)
+{
+    auto node = ImportedNode{};
+    std::string node_path;
+    if (!reader.read_string(node.name) || !reader.read_string(node_path) || !read_transform(reader, node.transform)) {
+        return {};
+    }
+    node.location = NodeLocation::file(source, node_path);
+
+    std::uint32_t mesh_count;
+    if (!reader.read(mesh_count)) {
+        return {};
+    }
+
+    for (std::uint32_t i = 0; i < mesh_count; ++i) {
+        auto& mesh = node.meshes.emplace_back();
+        std::uint32_t lod_count;
+        if (!reader.read_path(mesh.texture_diffuse)
+            || !reader.read_path(mesh.texture_opacity)
+            || !reader.read_string(mesh.unresolved_texture_diffuse)
+            || !reader.read(mesh.aabb)
+            || !reader.read(lod_count)) {
+            return {};
+        }
+
+        for (std::uint32_t lod = 0; lod < lod_count; ++lod) {
+            if (!reader.read(mesh.lods.emplace_back())) {
+                return {};
+            }
+        }
+
+        std::uint32_t vertex_count;
+        std::uint32_t index_count;
+        auto const success = reader.read(vertex_count)
+            && reader.read(index_count)
+            && reader.read(mesh.mapped_geometry.index_type)
+            && (mesh.mapped_geometry.index_type == IndexType::UINT16 || mesh.mapped_geometry.index_type == IndexType::UINT32)
+            && (vertex_format == VertexFormat::QUANTIZED
+                    ? reader.read_span(mesh.mapped_geometry.quantized_vertices, vertex_count)
+                    : reader.read_span(mesh.mapped_geometry.vertices, vertex_count))
+            && reader.read_span(mesh.mapped_geometry.indices, index_count * index_size(mesh.mapped_geometry.index_type))
+            && std::all_of(mesh.lods.begin(), mesh.lods.end(), [&](auto const& lod) {
+                   return static_cast<std::uint64_t>(lod.index_offset) + lod.index_count <= index_count;
+               });
+        if (!success) {
+            return {};
+        }
+        mesh.mapped_geometry.file = file;
+    }
+
+    std::uint32_t child_count;
+    if (!reader.read(child_count)) {
+        return {};
+    }
+
+    for (std::uint32_t i = 0; i < child_count; ++i) {
+        auto child = read_node(reader, source, vertex_format, file);
+        if (!child.has_value()) {
+            return {};
+        }
+        node.children.push_back(std::move(child.value()));
+    }
+
+    return node;
+}
+
+std::filesystem::path MeshCache::cache_file(std::filesystem::path cache_directory, std::filesystem::path source)
+{
+    auto const hash = std::hash<std::string>{}(source.generic_string());
+    return cache_directory / "models" / (std::to_string(hash) + ".mesh");
+}
+
+std::optional<ImportedNode> MeshCache::load(std::filesystem::path cache_file, std::filesystem::path source, unsigned int import_flags, ImportOptions const& options)
+{
+    try {
+        if (!std::filesystem::is_regular_file(cache_file)) {
+            return {};
+        }
+
+        // The meshes keep the mapping alive until their geometry is uploaded
+        auto mapped_file = MappedFile::open(cache_file);
+        if (!mapped_file.has_value()) {
+            return {};
+        }
+        auto file = std::make_shared<MappedFile const>(std::move(mapped_file.value()));
+
+        auto reader = CacheReader{file->data()};
+
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t flags;
+        VertexFormat vertex_format;
+        std::uint8_t weld_vertices;
+        WeldTolerance weld_tolerance;
+        std::uint8_t optimize_meshes;
+        std::uint8_t generate_lods;
+        std::int64_t mtime;
+        std::string source_path;
+        auto const header_valid = reader.read(magic)
+            && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+            && reader.read(version) && version == VERSION
+            && reader.read(flags) && flags == import_flags
+            && reader.read(vertex_format) && vertex_format == options.vertex_format
+            && reader.read(weld_vertices) && weld_vertices == options.weld_vertices
+            && reader.read(weld_tolerance) && weld_tolerance == options.weld_tolerance
+            && reader.read(optimize_meshes) && optimize_meshes == options.optimize_meshes
+            && reader.read(generate_lods) && generate_lods == options.generate_lods
+            && reader.read(mtime) && mtime == CacheFile::source_mtime(source)
+            && reader.read_string(source_path) && source_path == source.generic_string();
+        if (!header_valid) {
+            return {};
+        }
+
+        auto root = read_node(reader, source, options.vertex_format, file);
+        if (!root.has_value()) {
+            std::cerr << "Mesh cache " << cache_file << " is corrupted\n";
+        }
+
+        return root;
+    } catch (std::exception const& e) {
+        std::cerr << "Failed to read mesh cache " << cache_file << ": " << e.what() << "\n";
+        return {};
+    }
+}
+
+bool MeshCache::store(std::filesystem::path cache_file, std::filesystem::path source, unsigned int import_flags, ImportOptions const& options, ImportedNode const& root)
+{
+    auto writer = CacheWriter{};
+    writer.write(MAGIC);
+    writer.write(VERSION);
+    writer.write(static_cast<std::uint32_t>(import_flags));
+    writer.write(options.vertex_format);
+    writer.write(static_cast<std::uint8_t>(options.weld_vertices));
+    writer.write(options.weld_tolerance);
+    writer.write(static_cast<std::uint8_t>(options.optimize_meshes));
+    writer.write(static_cast<std::uint8_t>(options.generate_lods));
+
+    try {
+        writer.write(CacheFile::source_mtime(source));
+        writer.write_string(source.generic_string());
+        write_node(writer, root);
+
+        if (!CacheFile::write(cache_file, writer.buffer())) {
+            return false;
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "Failed to write mesh cache " << cache_file << ": " << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,733 @@
+#include "core/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+
+// Tuning values from the paper. The cache is modelled as LRU, which also works well for FIFO hardware caches.
+constexpr std::size_t CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+// Vertices with more remaining triangles all get the same valence boost
+constexpr std::size_t MAX_VALENCE = 64;
+
+constexpr auto NO_TRIANGLE = std::numeric_limits<std::size_t>::max();
+
+struct ScoreTable {
+    // Indexed with the cache position + 1, so vertices outside of the cache use index 0
+    std::array<float, CACHE_SIZE + 1> cache;
+    // Indexed with the number of remaining triangles
+    std::array<float, MAX_VALENCE + 1> valence;
+
+    ScoreTable()
+    {
+        cache[0] = 0.0f;
+        for (std::size_t position = 0; position < CACHE_SIZE; ++position) {
+            // The vertices of the last triangle get a fixed score, so they aren't favoured too much
+            cache[position + 1] = position < 3
+                ? LAST_TRIANGLE_SCORE
+                : std::pow(1.0f - static_cast<float>(position - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+        }
+
+        valence[0] = 0.0f;
+        for (std::size_t count = 1; count <= MAX_VALENCE; ++count) {
+            valence[count] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(count), -VALENCE_BOOST_POWER);
+        }
+    }
+
+    float score(int cache_position, std::size_t remaining_triangles) const
+    {
+        // Vertices without remaining triangles don't pull any triangle
+        if (remaining_triangles == 0) {
+            return -1.0f;
+        }
+
+        return cache[cache_position + 1] + valence[std::min(remaining_triangles, MAX_VALENCE)];
+    }
+};
+
+bool is_within(Vertex const& a, Vertex const& b, WeldTolerance const& tolerance)
+{
+    for (int i = 0; i < 3; ++i) {
+        if (std::abs(a.m_position[i] - b.m_position[i]) > tolerance.position
+            || std::abs(a.m_normal[i] - b.m_normal[i]) > tolerance.normal) {
+            return false;
+        }
+    }
+
+    return std::abs(a.m_tex_coords.x - b.m_tex_coords.x) <= tolerance.tex_coords
+        && std::abs(a.m_tex_coords.y - b.m_tex_coords.y) <= tolerance.tex_coords;
+}
+
+std::uint64_t hash_cell(std::array<std::int64_t, 3> const& cell)
+{
+    // Colliding cells only add candidates that fail the tolerance check
+    auto hash = static_cast<std::uint64_t>(cell[0]) * 0x9E3779B97F4A7C15ull;
+    hash ^= static_cast<std::uint64_t>(cell[1]) * 0xC2B2AE3D27D4EB4Full + (hash << 6) + (hash >> 2);
+    hash ^= static_cast<std::uint64_t>(cell[2]) * 0x165667B19E3779F9ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+std::size_t MeshOptimizer::weld_vertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, WeldTolerance const& tolerance)
+{
+    constexpr auto NO_VERTEX = std::numeric_limits<unsigned int>::max();
+
+    // Vertices are bucketed by position. With a tolerance, the buckets are a grid with the tolerance as cell size
+    // and the neighbouring cells are searched as well. Without one, the buckets are the exact bit patterns.
+    auto const use_grid = tolerance.position > 0.0f;
+    auto cell_of = [&](glm::vec3 const& position) {
+        auto cell = std::array<std::int64_t, 3>{};
+        for (int i = 0; i < 3; ++i) {
+            cell[i] = use_grid
+                ? static_cast<std::int64_t>(std::floor(position[i] / tolerance.position))
+                // Adding 0 turns -0 into 0, so both end up in the same bucket
+                : std::bit_cast<std::int32_t>(position[i] + 0.0f);
+        }
+        return cell;
+    };
+    auto const search_radius = use_grid ? 1 : 0;
+
+    // Each bucket is a linked list of welded vertices
+    auto buckets = std::unordered_map<std::uint64_t, unsigned int>{};
+    buckets.reserve(vertices.size());
+    auto next_in_bucket = std::vector<unsigned int>{};
+    auto welded = std::vector<Vertex>{};
+    welded.reserve(vertices.size());
+    auto remap = std::vector<unsigned int>(vertices.size());
+
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        auto const& vertex = vertices[i];
+        auto const cell = cell_of(vertex.m_position);
+
+        auto match = NO_VERTEX;
+        for (auto dx = -search_radius; dx <= search_radius && match == NO_VERTEX; ++dx) {
+            for (auto dy = -search_radius; dy <= search_radius && match == NO_VERTEX; ++dy) {
+                for (auto dz = -search_radius; dz <= search_radius && match == NO_VERTEX; ++dz) {
+                    auto it = buckets.find(hash_cell({cell[0] + dx, cell[1] + dy, cell[2] + dz}));
+                    if (it == buckets.end()) {
+                        continue;
+                    }
+
+                    for (auto candidate = it->second; candidate != NO_VERTEX; candidate = next_in_bucket[candidate]) {
+                        if (is_within(welded[candidate], vertex, tolerance)) {
+                            match = candidate;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (match == NO_VERTEX) {
+            match = static_cast<unsigned int>(welded.size());
+            welded.push_back(vertex);
+            auto [it, is_new] = buckets.try_emplace(hash_cell(cell), match);
+            next_in_bucket.push_back(is_new ? NO_VERTEX : it->second);
+            it->second = match;
+        }
+
+        remap[i] = match;
+    }
+
+    // Remap the indices and drop triangles that collapsed to a line or a point
+    std::size_t kept = 0;
+    for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+        auto const a = remap[indices[t]];
+        auto const b = remap[indices[t + 1]];
+        auto const c = remap[indices[t + 2]];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+
+        indices[kept++] = a;
+        indices[kept++] = b;
+        indices[kept++] = c;
+    }
+    indices.resize(kept);
+
+    auto const removed = vertices.size() - welded.size();
+    vertices = std::move(welded);
+    return removed;
+}
+
+float MeshOptimizer::acmr(std::span<unsigned int const> indices, std::size_t vertex_count, std::size_t cache_size)
+{
+    if (indices.size() < 3) {
+        return 0.0f;
+    }
+
+    // A vertex is in the FIFO cache if less than `cache_size` vertices were inserted after it.
+    // Stamps are offset by one, so 0 means the vertex was never transformed.
+    auto inserted_at = std::vector<std::size_t>(vertex_count, 0);
+    std::size_t misses = 0;
+    for (auto index : indices) {
+        auto& stamp = inserted_at[index];
+        if (stamp == 0 || misses - (stamp - 1) >= cache_size) {
+            stamp = misses + 1;
+            ++misses;
+        }
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+void MeshOptimizer::optimize_vertex_cache(std::vector<unsigned int>& indices, std::size_t vertex_count)
+{
+    static auto const score_table = ScoreTable{};
+
+    auto const triangle_count = indices.size() / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    // Triangles that use each vertex. The first `remaining_triangles[v]` entries of a vertex are the ones
+    // that are not emitted yet, emitted triangles are swapped behind them.
+    auto adjacency_offsets = std::vector<std::size_t>(vertex_count + 1, 0);
+    for (std::size_t i = 0; i < triangle_count * 3; ++i) {
+        ++adjacency_offsets[indices[i] + 1];
+    }
+    for (std::size_t v = 0; v < vertex_count; ++v) {
+        adjacency_offsets[v + 1] += adjacency_offsets[v];
+    }
+
+    auto remaining_triangles = std::vector<std::size_t>(vertex_count, 0);
+    auto adjacency = std::vector<std::size_t>(triangle_count * 3);
+    for (std::size_t i = 0; i < triangle_count * 3; ++i) {
+        auto const v = indices[i];
+        adjacency[adjacency_offsets[v] + remaining_triangles[v]++] = i / 3;
+    }
+
+    auto cache_positions = std::vector<int>(vertex_count, -1);
+    auto vertex_scores = std::vector<float>(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; ++v) {
+        vertex_scores[v] = score_table.score(-1, remaining_triangles[v]);
+    }
+
+    auto triangle_scores = std::vector<float>(triangle_count);
+    auto is_emitted = std::vector<bool>(triangle_count, false);
+    auto best_triangle = NO_TRIANGLE;
+    for (std::size_t t = 0; t < triangle_count; ++t) {
+        triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+        if (best_triangle == NO_TRIANGLE || triangle_scores[t] > triangle_scores[best_triangle]) {
+            best_triangle = t;
+        }
+    }
+
+    auto result = std::vector<unsigned int>{};
+    result.reserve(triangle_count * 3);
+
+    // Holds up to three more entries than the cache while it is being updated
+    auto cache = std::vector<unsigned int>{};
+    auto new_cache = std::vector<unsigned int>{};
+    cache.reserve(CACHE_SIZE + 3);
+    new_cache.reserve(CACHE_SIZE + 3);
+
+    std::size_t next_unemitted = 0;
+    while (best_triangle != NO_TRIANGLE) {
+        is_emitted[best_triangle] = true;
+        auto const* triangle = &indices[best_triangle * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+
+        // Remove the triangle from the remaining triangles of its vertices
+        for (std::size_t i = 0; i < 3; ++i) {
+            auto const v = triangle[i];
+            auto* begin = adjacency.data() + adjacency_offsets[v];
+            auto* end = begin + remaining_triangles[v];
+            auto* it = std::find(begin, end, best_triangle);
+            if (it != end) {
+                std::swap(*it, *(end - 1));
+                --remaining_triangles[v];
+            }
+        }
+
+        // Move the vertices of the triangle to the front of the LRU cache
+        new_cache.clear();
+        for (std::size_t i = 0; i < 3; ++i) {
+            if (std::find(new_cache.begin(), new_cache.end(), triangle[i]) == new_cache.end()) {
+                new_cache.push_back(triangle[i]);
+            }
+        }
+        // Degenerate triangles have less than three distinct vertices
+        auto const triangle_vertices = new_cache.size();
+        for (auto v : cache) {
+            if (std::find(new_cache.begin(), new_cache.begin() + triangle_vertices, v) == new_cache.begin() + triangle_vertices) {
+                new_cache.push_back(v);
+            }
+        }
+
+        // Update the scores of the cached and the evicted vertices, then of the triangles that use them
+        for (std::size_t i = 0; i < new_cache.size(); ++i) {
+            auto const v = new_cache[i];
+            cache_positions[v] = i < CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertex_scores[v] = score_table.score(cache_positions[v], remaining_triangles[v]);
+        }
+
+        best_triangle = NO_TRIANGLE;
+        for (auto v : new_cache) {
+            auto const* begin = adjacency.data() + adjacency_offsets[v];
+            for (auto const* it = begin; it != begin + remaining_triangles[v]; ++it) {
+                auto const t = *it;
+                triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+                if (best_triangle == NO_TRIANGLE || triangle_scores[t] > triangle_scores[best_triangle]) {
+                    best_triangle = t;
+                }
+            }
+        }
+
+        new_cache.resize(std::min(new_cache.size(), CACHE_SIZE));
+        std::swap(cache, new_cache);
+
+        // Nothing in the cache is connected to a remaining triangle, continue with the next one in the
+        // original order. Searching for the best score instead would make the optimisation quadratic.
+        if (best_triangle == NO_TRIANGLE) {
+            while (next_unemitted < triangle_count && is_emitted[next_unemitted]) {
+                ++next_unemitted;
+            }
+            if (next_unemitted < triangle_count) {
+                best_triangle = next_unemitted;
+            }
+        }
+    }
+
+    // Indices of an incomplete last triangle are dropped, they were never drawn anyway
+    indices = std::move(result);
+}
+
+void MeshOptimizer::optimize_vertex_fetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    constexpr auto UNUSED = std::numeric_limits<unsigned int>::max();
+
+    auto remap = std::vector<unsigned int>(vertices.size(), UNUSED);
+    auto reordered = std::vector<Vertex>{};
+    reordered.reserve(vertices.size());
+
+    for (auto& index : indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+}
+
+// Sum of the squared distances to a set of planes, weighted by their area. The symmetric 4x4 matrix is stored as
+// its upper triangle. Doubles, because the terms of large city meshes cancel out badly in single precision.
+struct Quadric {
+    double xx{0.0}, xy{0.0}, xz{0.0}, xw{0.0}, yy{0.0}, yz{0.0}, yw{0.0}, zz{0.0}, zw{0.0}, ww{0.0};
+    double weight{0.0};
+
+    static Quadric plane(glm::vec3 const& normal, glm::vec3 const& point, double weight)
+    {
+        double const a = normal.x;
+        double const b = normal.y;
+        double const c = normal.z;
+        double const d = -(a * point.x + b * point.y + c * point.z);
+        return Quadric{
+            a * a * weight, a * b * weight, a * c * weight, a * d * weight,
+            b * b * weight, b * c * weight, b * d * weight,
+            c * c * weight, c * d * weight,
+            d * d * weight,
+            weight,
+        };
+    }
+
+    Quadric& operator+=(Quadric const& other)
+    {
+        xx += other.xx;
+        xy += other.xy;
+        xz += other.xz;
+        xw += other.xw;
+        yy += other.yy;
+        yz += other.yz;
+        yw += other.yw;
+        zz += other.zz;
+        zw += other.zw;
+        ww += other.ww;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Root of the mean squared distance of the point to the planes
+    float error(glm::vec3 const& point) const
+    {
+        if (weight <= 0.0) {
+            return 0.0f;
+        }
+
+        double const x = point.x;
+        double const y = point.y;
+        double const z = point.z;
+        auto const sum = xx * x * x + yy * y * y + zz * z * z
+            + 2.0 * (xy * x * y + xz * x * z + yz * y * z + xw * x + yw * y + zw * z)
+            + ww;
+        return static_cast<float>(std::sqrt(std::max(sum, 0.0) / weight));
+    }
+};
+
+// Edges on the border of the mesh get a perpendicular plane with this weight relative to the triangles,
+// so the silhouette doesn't shrink
+constexpr double BORDER_WEIGHT = 10.0;
+
+// Lists of values per key, stored in one array
+struct Adjacency {
+    std::vector<std::size_t> offsets;
+    std::vector<unsigned int> values;
+
+    std::span<unsigned int const> operator[](std::size_t key) const
+    {
+        return {values.data() + offsets[key], offsets[key + 1] - offsets[key]};
+    }
+};
+
+// `for_each_pair(add)` must call `add(key, value)` for every pair, it is called twice
+template <typename ForEachPair>
+Adjacency build_adjacency(std::size_t key_count, ForEachPair&& for_each_pair)
+{
+    auto adjacency = Adjacency{
+        .offsets = std::vector<std::size_t>(key_count + 1, 0),
+        .values = {},
+    };
+    for_each_pair([&](std::size_t key, unsigned int) { ++adjacency.offsets[key + 1]; });
+    std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+    adjacency.values.resize(adjacency.offsets.back());
+    auto fill = std::vector<std::size_t>(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for_each_pair([&](std::size_t key, unsigned int value) { adjacency.values[fill[key]++] = value; });
+
+    return adjacency;
+}
+
+std::uint64_t edge_key(unsigned int a, unsigned int b)
+{
+    return static_cast<std::uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+}
+
+float MeshOptimizer::simplify(std::span<Vertex const> vertices, std::vector<unsigned int>& indices, std::size_t target_index_count, float target_error)
+{
+    constexpr auto NO_VERTEX = std::numeric_limits<unsigned int>::max();
+    auto const vertex_count = vertices.size();
+    indices.resize(indices.size() / 3 * 3);
+
+    // 1. Vertices at the same position only differ in their attributes, for example along UV seams. They form a class
+    // that is collapsed as a whole, identified by its first vertex.
+    auto by_position = std::vector<unsigned int>(vertex_count);
+    std::iota(by_position.begin(), by_position.end(), 0);
+    auto position_less = [&](unsigned int a, unsigned int b) {
+        auto const& p = vertices[a].m_position;
+        auto const& q = vertices[b].m_position;
+        return std::tie(p.x, p.y, p.z) < std::tie(q.x, q.y, q.z);
+    };
+    std::sort(by_position.begin(), by_position.end(), position_less);
+
+    auto position_class = std::vector<unsigned int>(vertex_count);
+    for (std::size_t i = 0; i < vertex_count; ++i) {
+        auto const v = by_position[i];
+        auto const is_same_position = i > 0 && !position_less(by_position[i - 1], v);
+        position_class[v] = is_same_position ? position_class[by_position[i - 1]] : v;
+    }
+
+    auto const class_members = build_adjacency(vertex_count, [&](auto&& add) {
+        for (unsigned int v = 0; v < vertex_count; ++v) {
+            add(position_class[v], v);
+        }
+    });
+
+    auto position = [&](unsigned int vertex_or_class) -> glm::vec3 const& {
+        return vertices[vertex_or_class].m_position;
+    };
+    auto triangle_classes = [&](std::size_t t) {
+        return std::array<unsigned int, 3>{
+            position_class[indices[t * 3]],
+            position_class[indices[t * 3 + 1]],
+            position_class[indices[t * 3 + 2]],
+        };
+    };
+
+    // 2. Quadrics of the triangle planes and of planes that keep border edges in place
+    auto quadrics = std::vector<Quadric>(vertex_count);
+    auto edge_uses = std::unordered_map<std::uint64_t, unsigned int>{};
+    for (std::size_t t = 0; t < indices.size() / 3; ++t) {
+        auto const c = triangle_classes(t);
+        for (int i = 0; i < 3; ++i) {
+            ++edge_uses[edge_key(c[i], c[(i + 1) % 3])];
+        }
+
+        auto const normal = glm::cross(position(c[1]) - position(c[0]), position(c[2]) - position(c[0]));
+        auto const length = glm::length(normal);
+        if (length == 0.0f) {
+            continue;
+        }
+
+        auto const quadric = Quadric::plane(normal / length, position(c[0]), length * 0.5);
+        for (int i = 0; i < 3; ++i) {
+            quadrics[c[i]] += quadric;
+        }
+    }
+
+    for (std::size_t t = 0; t < indices.size() / 3; ++t) {
+        auto const c = triangle_classes(t);
+        auto const normal = glm::cross(position(c[1]) - position(c[0]), position(c[2]) - position(c[0]));
+        for (int i = 0; i < 3; ++i) {
+            auto const a = c[i];
+            auto const b = c[(i + 1) % 3];
+            if (edge_uses[edge_key(a, b)] != 1) {
+                continue;
+            }
+
+            auto const edge = position(b) - position(a);
+            auto const border_normal = glm::cross(edge, normal);
+            auto const length = glm::length(border_normal);
+            if (length == 0.0f) {
+                continue;
+            }
+
+            auto const edge_length = glm::length(edge);
+            auto const quadric = Quadric::plane(border_normal / length, position(a), edge_length * edge_length * BORDER_WEIGHT);
+            quadrics[a] += quadric;
+            quadrics[b] += quadric;
+        }
+    }
+
+    // 3. Collapse edges in passes. Each pass sorts the possible collapses by their error and applies those
+    // that don't touch a region that was already changed in the same pass.
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        float error;
+    };
+
+    float max_error = 0.0f;
+    auto vertex_remap = std::vector<unsigned int>(vertex_count);
+    auto is_locked = std::vector<bool>(vertex_count);
+    auto is_referenced = std::vector<bool>(vertex_count);
+    auto collapses = std::vector<Collapse>{};
+    auto edges = std::vector<std::uint64_t>{};
+
+    while (indices.size() > target_index_count) {
+        auto const triangle_count = indices.size() / 3;
+
+        std::fill(is_referenced.begin(), is_referenced.end(), false);
+        for (auto index : indices) {
+            is_referenced[index] = true;
+        }
+
+        auto const vertex_neighbours = build_adjacency(vertex_count, [&](auto&& add) {
+            for (std::size_t i = 0; i < indices.size(); ++i) {
+                auto const corner = i % 3;
+                auto const first = i - corner;
+                add(indices[i], indices[first + (corner + 1) % 3]);
+                add(indices[i], indices[first + (corner + 2) % 3]);
+            }
+        });
+
+        auto const class_triangles = build_adjacency(vertex_count, [&](auto&& add) {
+            for (std::size_t t = 0; t < triangle_count; ++t) {
+                auto const c = triangle_classes(t);
+                add(c[0], static_cast<unsigned int>(t));
+                if (c[1] != c[0]) {
+                    add(c[1], static_cast<unsigned int>(t));
+                }
+                if (c[2] != c[0] && c[2] != c[1]) {
+                    add(c[2], static_cast<unsigned int>(t));
+                }
+            }
+        });
+
+        // The vertex of the target class that a vertex of the collapsed class moves to. It must share an edge,
+        // so attributes stay continuous. Vertices on seams can only move along the seam.
+        auto find_target = [&](unsigned int vertex, unsigned int to) {
+            for (auto neighbour : vertex_neighbours[vertex]) {
+                if (position_class[neighbour] == to) {
+                    return neighbour;
+                }
+            }
+            return NO_VERTEX;
+        };
+
+        auto can_collapse = [&](unsigned int from, unsigned int to) {
+            for (auto member : class_members[from]) {
+                if (is_referenced[member] && find_target(member, to) == NO_VERTEX) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // Moving a class must not turn any of its remaining triangles upside down, or tilt them so far
+        // that they become slivers
+        constexpr float MIN_NORMAL_COS = 0.25f;
+        auto flips_triangle = [&](unsigned int from, unsigned int to) {
+            for (auto t : class_triangles[from]) {
+                auto const c = triangle_classes(t);
+                if (c[0] == to || c[1] == to || c[2] == to) {
+                    continue;
+                }
+
+                std::array<glm::vec3, 3> corners = {position(c[0]), position(c[1]), position(c[2])};
+                auto const before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                for (int i = 0; i < 3; ++i) {
+                    if (c[i] == from) {
+                        corners[i] = position(to);
+                    }
+                }
+                auto const after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                if (glm::dot(before, after) <= MIN_NORMAL_COS * glm::length(before) * glm::length(after)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        edges.clear();
+        for (std::size_t t = 0; t < triangle_count; ++t) {
+            auto const c = triangle_classes(t);
+            for (int i = 0; i < 3; ++i) {
+                if (c[i] != c[(i + 1) % 3]) {
+                    edges.push_back(edge_key(c[i], c[(i + 1) % 3]));
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for (auto edge : edges) {
+            auto const a = static_cast<unsigned int>(edge >> 32);
+            auto const b = static_cast<unsigned int>(edge & 0xFFFFFFFFu);
+            auto quadric = quadrics[a];
+            quadric += quadrics[b];
+
+            // Collapse in the cheaper of the two directions that keeps the attributes continuous
+            auto const a_to_b = Collapse{a, b, quadric.error(position(b))};
+            auto const b_to_a = Collapse{b, a, quadric.error(position(a))};
+            auto const& cheaper = a_to_b.error <= b_to_a.error ? a_to_b : b_to_a;
+            auto const& other = a_to_b.error <= b_to_a.error ? b_to_a : a_to_b;
+            if (cheaper.error <= target_error && can_collapse(cheaper.from, cheaper.to)) {
+                collapses.push_back(cheaper);
+            } else if (other.error <= target_error && can_collapse(other.from, other.to)) {
+                collapses.push_back(other);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](auto const& a, auto const& b) { return a.error < b.error; });
+
+        std::iota(vertex_remap.begin(), vertex_remap.end(), 0);
+        std::fill(is_locked.begin(), is_locked.end(), false);
+        auto const triangles_to_remove = triangle_count - target_index_count / 3;
+        std::size_t removed_triangles = 0;
+        std::size_t applied = 0;
+
+        for (auto const& collapse : collapses) {
+            if (removed_triangles >= triangles_to_remove) {
+                break;
+            }
+
+            if (is_locked[collapse.from] || is_locked[collapse.to] || flips_triangle(collapse.from, collapse.to)) {
+                continue;
+            }
+
+            for (auto member : class_members[collapse.from]) {
+                if (is_referenced[member]) {
+                    vertex_remap[member] = find_target(member, collapse.to);
+                }
+            }
+
+            // The triangles around the collapsed class change, their other corners must wait for the next pass
+            for (auto t : class_triangles[collapse.from]) {
+                auto const c = triangle_classes(t);
+                for (auto corner : c) {
+                    is_locked[corner] = true;
+                }
+                if (c[0] == collapse.to || c[1] == collapse.to || c[2] == collapse.to) {
+                    ++removed_triangles;
+                }
+            }
+            is_locked[collapse.to] = true;
+
+            quadrics[collapse.to] += quadrics[collapse.from];
+            max_error = std::max(max_error, collapse.error);
+            ++applied;
+        }
+
+        if (applied == 0) {
+            break;
+        }
+
+        // Remap the indices and remove triangles that lost their area
+        std::size_t kept = 0;
+        for (std::size_t t = 0; t < triangle_count; ++t) {
+            std::array<unsigned int, 3> const corners = {
+                vertex_remap[indices[t * 3]],
+                vertex_remap[indices[t * 3 + 1]],
+                vertex_remap[indices[t * 3 + 2]],
+            };
+            auto const a = position_class[corners[0]];
+            auto const b = position_class[corners[1]];
+            auto const c = position_class[corners[2]];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+
+            indices[kept++] = corners[0];
+            indices[kept++] = corners[1];
+            indices[kept++] = corners[2];
+        }
+        indices.resize(kept);
+    }
+
+    return max_error;
+}
+
+std::vector<MeshLod> MeshOptimizer::generate_lods(std::span<Vertex const> vertices, std::vector<unsigned int>& indices, AABB const& aabb)
+{
+    // Each LOD aims for half the triangles of the previous one, within an error relative to the mesh size
+    constexpr std::size_t MAX_LODS = 4;
+    constexpr float TRIANGLE_RATIO = 0.5f;
+    constexpr std::array<float, MAX_LODS - 1> MAX_RELATIVE_ERROR = {0.005f, 0.02f, 0.08f};
+    // A LOD that can't remove at least this share of triangles isn't worth the index memory
+    constexpr float MIN_REDUCTION = 0.2f;
+    constexpr std::size_t MIN_TRIANGLES = 64;
+
+    auto lods = std::vector<MeshLod>{
+        MeshLod{0, static_cast<std::uint32_t>(indices.size()), 0.0f},
+    };
+
+    auto const diagonal = glm::length(aabb.max - aabb.min);
+    if (diagonal <= 0.0f || indices.size() / 3 < MIN_TRIANGLES) {
+        return lods;
+    }
+
+    auto previous = std::vector<unsigned int>(indices.begin(), indices.end());
+    float error = 0.0f;
+    for (std::size_t level = 1; level < MAX_LODS; ++level) {
+        auto lod = previous;
+        auto const target_index_count = static_cast<std::size_t>(static_cast<float>(previous.size() / 3) * TRIANGLE_RATIO) * 3;
+        auto const lod_error = simplify(vertices, lod, target_index_count, MAX_RELATIVE_ERROR[level - 1] * diagonal);
+        if (static_cast<float>(lod.size()) > static_cast<float>(previous.size()) * (1.0f - MIN_REDUCTION)) {
+            break;
+        }
+
+        // Simplifying from the previous LOD adds up the errors
+        error += lod_error;
+        optimize_vertex_cache(lod, vertices.size());
+
+        lods.push_back(MeshLod{
+            static_cast<std::uint32_t>(indices.size()),
+            static_cast<std::uint32_t>(lod.size()),
+            error / diagonal,
+        });
+        indices.insert(indices.end(), lod.begin(), lod.end());
+        previous = std::move(lod);
+    }
+
+    return lods;
+}
@@ -1,15 +1,23 @@
 #include "core/ModelLoader.hpp"
 
+#include "core/AsyncTaskQueue.hpp"
+#include "core/MeshCache.hpp"
 #include "core/Project.hpp"
+#include "core/VertexKernels.hpp"
 #include "renderer/Mesh.hpp"
 #include "renderer/Texture.hpp"
+#include <algorithm>
 #include <assimp/Importer.hpp>
+#include <assimp/ProgressHandler.hpp>
 #include <assimp/postprocess.h>
-#include <fstream>
 #include <glad/glad.h>
 #include <glm/gtc/quaternion.hpp>
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <set>
+#include <span>
+#include <tuple>
 #include <vector>
 
 glm::vec3 ai_to_glm_vec(aiVector3D vector)
@@ -17,14 +25,36 @@ glm::vec3 ai_to_glm_vec(aiVector3D vector)
     return glm::vec3{vector.x, vector.y, vector.z};
 }
 
-/*
- * Some texture paths in the given model are incorrect. This function makes some guesses
- * that correct most of them.
- */
-std::optional<std::filesystem::path> guess_texture_path(std::filesystem::path directory, std::string texture_path_string)
+// Texture paths that were not found on disk. Many meshes share a missing texture, and each of them
+// would scan the model directory again.
+struct DiskMisses {
+    std::mutex mutex;
+    std::set<std::pair<std::filesystem::path, std::string>> misses;
+};
+
+DiskMisses& disk_misses()
 {
-    std::replace(texture_path_string.begin(), texture_path_string.end(), '\\', '/');
-    auto texture_path = std::filesystem::path{texture_path_string};
+    static DiskMisses disk_misses;
+    return disk_misses;
+}
+
+// Compares lexically, so both paths have to be normalized
+bool is_inside(std::filesystem::path const& path, std::filesystem::path const& directory)
+{
+    auto const relative = path.lexically_relative(directory);
+    return !relative.empty() && *relative.begin() != "..";
+}
+
+// The same guesses as `guess_texture_path`, checked on disk
+std::optional<std::filesystem::path> guess_texture_path_on_disk(std::filesystem::path const& directory, std::filesystem::path const& texture_path)
+{
+    auto const key = std::make_pair(directory, texture_path.generic_string());
+    {
+        auto lock = std::lock_guard<std::mutex>{disk_misses().mutex};
+        if (disk_misses().misses.contains(key)) {
+            return {};
+        }
+    }
 
     // TODO: this fails on Windows without try/catch - requires investigation
     try {
@@ -59,128 +89,122 @@ std::optional<std::filesystem::path> guess_texture_path(std::filesystem::path di
     } catch (std::exception const& e) {
         std::cerr << "Failed to guess texture path: " << e.what() << "\n";
     }
-    // Fail
+
+    auto lock = std::lock_guard<std::mutex>{disk_misses().mutex};
+    disk_misses().misses.insert(key);
     return {};
 }
 
-Texture const* load_material_texture(aiMaterial* mat, aiTextureType type, std::filesystem::path directory)
+/*
+ * Some texture paths in the given model are incorrect. This function makes some guesses
+ * that correct most of them. The candidates are looked up by file name in the texture index of the project,
+ * so no guess touches the filesystem. Only models outside of the project look up their textures on disk.
+ */
+std::optional<std::filesystem::path> guess_texture_path(std::filesystem::path directory, std::string texture_path_string)
 {
-    if (mat->GetTextureCount(type) == 0) {
-        return nullptr;
+    std::replace(texture_path_string.begin(), texture_path_string.end(), '\\', '/');
+    auto texture_path = std::filesystem::path{texture_path_string};
+
+    auto project = Project::get_current();
+    assert(project);
+
+    // The paths of the index are normalized
+    directory = directory.lexically_normal();
+    auto filename = texture_path.filename().string();
+    auto candidates = project->find_textures_by_filename(filename);
+
+    // 1. Attempt: maybe the provided path is correct. The file name of the candidates already matched
+    // case-insensitively, so only the directory is compared.
+    auto const full_path = (directory / texture_path).lexically_normal();
+    for (auto const& candidate : candidates) {
+        if (candidate.parent_path() == full_path.parent_path()) {
+            return candidate;
+        }
     }
 
-    aiString string;
-    mat->GetTexture(type, 0, &string);
-    auto filename = std::string{string.C_Str()};
+    // 2. Attempt: maybe the file is in a subdirectory.
+    auto search_in_subdirectory = [&](std::vector<std::filesystem::path> const& paths) -> std::optional<std::filesystem::path> {
+        for (auto const& path : paths) {
+            if (path.parent_path().parent_path() == directory) {
+                return path;
+            }
+        }
+        return {};
+    };
 
-    auto texture_path = guess_texture_path(directory, filename);
-    if (!texture_path.has_value()) {
-        std::cout << "Failed to guess path for bogus texture name '" << filename << "'\n";
-        return nullptr;
+    if (auto optional_path = search_in_subdirectory(candidates); optional_path.has_value()) {
+        return optional_path.value();
+    }
+
+    // 3. Attempt: maybe the file is in a subdirectory and it ends on '..bmp', but the file ends on '_.bmp' (wtf?).
+    if (filename.ends_with("..bmp")) {
+        filename.erase(filename.size() - 5);
+        filename += "_.bmp";
+        if (auto optional_path = search_in_subdirectory(project->find_textures_by_filename(filename)); optional_path.has_value()) {
+            return optional_path.value();
+        }
     }
 
-    assert(Project::get_current() != nullptr);
-    auto texture = Project::get_current()->get_texture(texture_path.value());
+    if (is_inside(directory, project->root.lexically_normal())) {
+        return {};
+    }
 
-    return texture;
+    return guess_texture_path_on_disk(directory, texture_path);
 }
 
-Texture const* load_mask_texture(aiMaterial* mat, std::filesystem::path directory)
+std::optional<std::filesystem::path> find_material_texture(aiMaterial* mat, aiTextureType type, std::filesystem::path directory)
 {
-    if (mat->GetTextureCount(aiTextureType_DIFFUSE) == 0) {
-        return nullptr;
+    if (mat->GetTextureCount(type) == 0) {
+        return {};
     }
 
     aiString string;
-    mat->GetTexture(aiTextureType_DIFFUSE, 0, &string);
+    mat->GetTexture(type, 0, &string);
     auto filename = std::string{string.C_Str()};
 
     auto texture_path = guess_texture_path(directory, filename);
     if (!texture_path.has_value()) {
         std::cout << "Failed to guess path for bogus texture name '" << filename << "'\n";
-        return nullptr;
+        return {};
     }
 
+    return texture_path;
+}
+
+std::optional<std::filesystem::path> find_mask_texture(std::filesystem::path texture_diffuse)
+{
+    // Each texture has a <texture name>.mat file that links the base and mask texture guids.
+    // The materials are parsed with the fs cache, so this doesn't read the file.
     auto project = Project::get_current();
     assert(project);
-    auto material_cache_node_path = texture_path.value().replace_extension(".mat");
-
-    try {
-        auto material_file_stream = std::ifstream{material_cache_node_path};
-
-        std::string line;
-        bool in_mask_line = false;
-        std::optional<std::string> mask_texture_guid;
-        while (std::getline(material_file_stream, line)) {
-            if (in_mask_line) {
-                auto start_pos = line.find("guid: ");
-                if (start_pos == std::string::npos) {
-                    return nullptr;
-                }
-                auto const guid_length = 32;
-                mask_texture_guid = line.substr(start_pos + 6, guid_length);
-                break;
-            }
-
-            auto start_pos = line.find_first_not_of(" ");
-            if (line.compare(start_pos, 7, "- _Mask") != 0) {
-                continue;
-            }
-
-            in_mask_line = true;
-        }
-
-        if (!mask_texture_guid.has_value()) {
-            return nullptr;
-        }
-
-        auto mask_path = project->get_fs_cache_from_guid(mask_texture_guid.value());
-        if (!mask_path.has_value()) {
-            return nullptr;
-        }
+    auto material = project->get_unity_material(texture_diffuse.replace_extension(".mat"));
+    if (!material) {
+        return {};
+    }
 
-        return project->get_texture(mask_path.value());
-    } catch (std::exception&) {
-        return nullptr;
+    auto mask_texture_guid = material->mask_texture_guid();
+    if (!mask_texture_guid.has_value()) {
+        return {};
     }
+
+    return project->get_fs_cache_from_guid(mask_texture_guid.value());
 }
 
-Mesh process_mesh(aiMesh* mesh, aiScene const* scene, std::filesystem::path directory)
+// The kernels read the assimp vectors as plain float arrays
+static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "assimp must be built without double precision");
+
+ImportedMesh process_mesh(aiMesh* mesh, aiScene const* scene, std::filesystem::path directory)
 {
-    std::vector<Vertex> vertices;
+    auto vertices = std::vector<Vertex>(mesh->mNumVertices);
     std::vector<unsigned int> indices;
 
-    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-        Vertex vertex;
-        glm::vec3 vector;
-        vector.x = mesh->mVertices[i].x;
-        vector.y = mesh->mVertices[i].y;
-        vector.z = mesh->mVertices[i].z;
-        vertex.m_position = vector;
-
-        // normals
-        if (mesh->HasNormals()) {
-            vector.x = mesh->mNormals[i].x;
-            vector.y = mesh->mNormals[i].y;
-            vector.z = mesh->mNormals[i].z;
-            vertex.m_normal = vector;
-        }
-
-        // texture coordinates
-        if (mesh->mTextureCoords[0]) {
-            glm::vec2 tex_coord_vec;
-            tex_coord_vec.x = mesh->mTextureCoords[0][i].x;
-            tex_coord_vec.y = mesh->mTextureCoords[0][i].y;
-            vertex.m_tex_coords = tex_coord_vec;
-        } else {
-            vertex.m_tex_coords = {0.0f, 0.0f};
-        }
-
-        vertices.push_back(vertex);
-
-        // if you want to add more attributes do it here
-    }
+    VertexKernels::interleave(vertices,
+        reinterpret_cast<float const*>(mesh->mVertices),
+        mesh->HasNormals() ? reinterpret_cast<float const*>(mesh->mNormals) : nullptr,
+        mesh->mTextureCoords[0] ? reinterpret_cast<float const*>(mesh->mTextureCoords[0]) : nullptr);
 
+    // Faces are triangulated
+    indices.reserve(static_cast<std::size_t>(mesh->mNumFaces) * 3);
     for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
         aiFace face = mesh->mFaces[i];
         for (unsigned int j = 0; j < face.mNumIndices; ++j) {
@@ -191,28 +215,48 @@ Mesh process_mesh(aiMesh* mesh, aiScene const* scene, std::filesystem::path dire
     // assign materials if any
     auto material = scene->mMaterials[mesh->mMaterialIndex];
 
-    auto texture_diffuse = load_material_texture(material, aiTextureType_DIFFUSE, directory);
-    if (!texture_diffuse) {
-        texture_diffuse = Project::get_current()->fallback_texture();
+    auto texture_diffuse = find_material_texture(material, aiTextureType_DIFFUSE, directory);
+    std::string unresolved_texture_diffuse;
+    if (material->GetTextureCount(aiTextureType_DIFFUSE) > 0 && !texture_diffuse.has_value()) {
+        aiString string;
+        material->GetTexture(aiTextureType_DIFFUSE, 0, &string);
+        unresolved_texture_diffuse = string.C_Str();
     }
 
-    // TODO: Find mask texture
     // Each texture has a <texture name>.meta file that includes a guid
     // And each material has a list of linked textures that include a base and mask texture guid
-    auto texture_opacity = load_mask_texture(material, directory);
-    if (!texture_opacity) {
-        texture_opacity = Project::get_current()->white_texture();
-    }
-
-    auto aabb = AABB{
-        .min = ai_to_glm_vec(mesh->mAABB.mMin),
-        .max = ai_to_glm_vec(mesh->mAABB.mMax),
+    auto texture_opacity = texture_diffuse.has_value()
+        ? find_mask_texture(texture_diffuse.value())
+        : std::nullopt;
+
+    auto const aabb = VertexKernels::compute_aabb(vertices);
+
+    return ImportedMesh{
+        .vertices = std::move(vertices),
+        .quantized_vertices = {},
+        .indices = std::move(indices),
+        .lods = {},
+        .mapped_geometry = {},
+        .texture_diffuse = texture_diffuse,
+        .texture_opacity = texture_opacity,
+        .unresolved_texture_diffuse = std::move(unresolved_texture_diffuse),
+        .aabb = aabb,
     };
-
-    return Mesh{vertices, indices, texture_diffuse, texture_opacity, aabb};
 }
 
-Node process_node(aiNode* node, aiScene const* scene, std::filesystem::path directory, NodeLocation parent_location)
+// One node of the assimp scene. The skeleton of the imported tree is built serially, then the meshes
+// of all nodes are converted in parallel.
+struct NodeJob {
+    aiNode const* source;
+    ImportedNode* node;
+    // Index of the parent job, the root has none
+    std::optional<std::size_t> parent;
+    // Converted meshes of the node, before they are merged
+    std::vector<ImportedMesh> meshes;
+    glm::vec3 center{0.0f};
+};
+
+void create_node_skeleton(aiNode const* node, ImportedNode& new_node, NodeLocation parent_location, std::optional<std::size_t> parent, std::vector<NodeJob>& jobs)
 {
     aiVector3D scale;
     aiQuaternion rotation;
@@ -228,76 +272,325 @@ Node process_node(aiNode* node, aiScene const* scene, std::filesystem::path dire
     auto name = node->mName.C_Str();
 
     auto location = NodeLocation::file(parent_location.file_path, parent_location.node_path / name);
-    auto new_node = Node::create(name, new_transform, location);
+    new_node = ImportedNode{
+        .transform = new_transform,
+        .children = std::vector<ImportedNode>(node->mNumChildren),
+        .meshes = {},
+        .name = name,
+        .location = location,
+    };
+
+    auto const index = jobs.size();
+    jobs.push_back(NodeJob{
+        .source = node,
+        .node = &new_node,
+        .parent = parent,
+        .meshes = std::vector<ImportedMesh>(node->mNumMeshes),
+        .center = glm::vec3{0.0f},
+    });
 
-    std::map<std::pair<Texture const*, Texture const*>, Mesh> merged_meshes;
+    // The children are sized up front, so the pointers to them stay valid
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        create_node_skeleton(node->mChildren[i], new_node.children[i], location, index, jobs);
+    }
+}
 
-    // This messy code transforms the vertices and the positions in such a way that the mesh vertices are built around the object center.
-    // This ensures that the gizmos aren't diplayed somewhere far away.
-    // It also merges meshes with identical textures to improve performance.
+// This messy code transforms the vertices and the positions in such a way that the mesh vertices are built around the object center.
+// This ensures that the gizmos aren't diplayed somewhere far away.
+// It also merges meshes with identical textures to improve performance.
+void merge_and_center_meshes(NodeJob& job)
+{
+    // Meshes with different missing textures are kept apart, they may be resolved differently later
+    using Textures = std::tuple<std::optional<std::filesystem::path>, std::optional<std::filesystem::path>, std::string>;
+    std::map<Textures, ImportedMesh> merged_meshes;
 
-    // 1. Load all meshes and compute the node's AABB
+    // 1. Merge the meshes and compute the node's AABB
     std::optional<AABB> aabb;
-    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        auto new_mesh = process_mesh(mesh, scene, directory);
+    for (auto& new_mesh : job.meshes) {
         if (!aabb.has_value()) {
             aabb = new_mesh.aabb;
         } else {
             aabb = aabb->merge(new_mesh.aabb);
         }
 
-        auto key = std::make_pair(new_mesh.m_texture_diffuse, new_mesh.m_texture_opacity);
+        auto key = std::make_tuple(new_mesh.texture_diffuse, new_mesh.texture_opacity, new_mesh.unresolved_texture_diffuse);
         if (merged_meshes.contains(key)) {
             auto& merged_mesh = merged_meshes.at(key);
-            auto start_index = merged_mesh.m_vertices.size();
-            for (auto index : new_mesh.m_indices) {
-                merged_mesh.m_indices.push_back(start_index + index);
+            auto start_index = merged_mesh.vertices.size();
+            for (auto index : new_mesh.indices) {
+                merged_mesh.indices.push_back(start_index + index);
             }
-            merged_mesh.m_vertices.insert(merged_mesh.m_vertices.end(), new_mesh.m_vertices.begin(), new_mesh.m_vertices.end());
+            merged_mesh.vertices.insert(merged_mesh.vertices.end(), new_mesh.vertices.begin(), new_mesh.vertices.end());
+            merged_mesh.aabb = merged_mesh.aabb.merge(new_mesh.aabb);
         } else {
             merged_meshes.emplace(key, std::move(new_mesh));
         }
     }
+    job.meshes = {};
 
     // 2. Compute the offset to the center in local space
-    auto center = glm::vec3{0.0f};
     if (aabb.has_value()) {
-        center = glm::vec3{
+        job.center = glm::vec3{
             aabb->min.x + (aabb->max.x - aabb->min.x) / 2,
             aabb->min.y + (aabb->max.y - aabb->min.y) / 2,
             aabb->min.z + (aabb->max.z - aabb->min.z) / 2,
         };
     }
 
-    // 3. Move vertices, setup mesh buffers and add the meshes to the node
+    // 3. Move vertices and add the meshes to the node
     for (auto& [_, mesh] : merged_meshes) {
-        for (auto& vertex : mesh.m_vertices) {
-            vertex.m_position -= center;
+        VertexKernels::translate(mesh.vertices, -job.center);
+        mesh.aabb.min -= job.center;
+        mesh.aabb.max -= job.center;
+        job.node->meshes.push_back(std::move(mesh));
+    }
+
+    // 4. Move own position, the parent moves it by its own center afterwards
+    auto& transform = job.node->transform;
+    transform.position = glm::vec3{transform.get_local_matrix() * glm::vec4{job.center, 1.0f}};
+}
+
+ImportedNode process_node(aiNode const* root, aiScene const* scene, std::filesystem::path directory, NodeLocation root_location)
+{
+    auto root_node = ImportedNode{};
+    std::vector<NodeJob> jobs;
+    create_node_skeleton(root, root_node, root_location, {}, jobs);
+
+    // Every mesh is converted on its own, so a node with thousands of meshes is spread over all workers too
+    std::vector<std::pair<std::size_t, unsigned int>> mesh_slots;
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        for (unsigned int j = 0; j < jobs[i].source->mNumMeshes; ++j) {
+            mesh_slots.emplace_back(i, j);
         }
-        mesh.aabb.min -= center;
-        mesh.aabb.max -= center;
-        mesh.setup_mesh();
-        new_node.meshes.push_back(std::move(mesh));
     }
 
-    // 4. Load and move the child nodes
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        auto new_child = process_node(node->mChildren[i], scene, directory, location);
-        new_child.transform.position -= center;
-        new_node.children.push_back(std::move(new_child));
+    // The user waits for the import, so it runs before anything that is not needed right now
+    auto const priority = AsyncTaskQueue::Priority::VISIBLE_NOW;
+
+    auto convert_mesh = [&](std::size_t i) {
+        auto [job_index, mesh_index] = mesh_slots[i];
+        auto& job = jobs[job_index];
+        job.meshes[mesh_index] = process_mesh(scene->mMeshes[job.source->mMeshes[mesh_index]], scene, directory);
+    };
+    AsyncTaskQueue::background.parallel_for(mesh_slots.size(), convert_mesh, priority);
+
+    auto merge_meshes = [&](std::size_t i) {
+        merge_and_center_meshes(jobs[i]);
+    };
+    AsyncTaskQueue::background.parallel_for(jobs.size(), merge_meshes, priority);
+
+    // The centers of all nodes are known now, move the children into the space of their centered parent
+    for (auto const& job : jobs) {
+        if (job.parent.has_value()) {
+            job.node->transform.position -= jobs[job.parent.value()].center;
+        }
     }
 
-    // 5. Move own position
-    new_node.transform.position = glm::vec3{new_node.transform.get_local_matrix() * glm::vec4{center, 1.0f}};
+    return root_node;
+}
 
-    return new_node;
+// Statistics of the processing steps of a single mesh, summed up after all meshes are processed
+struct WeldStats {
+    std::size_t vertex_count_before{0};
+    std::size_t vertex_count_after{0};
+};
+
+// Simulated vertex shader invocations
+struct OptimizationStats {
+    std::size_t triangle_count{0};
+    float transformed_vertices_before{0.0f};
+    float transformed_vertices_after{0.0f};
+};
+
+// Triangles per LOD level
+using LodStats = std::vector<std::size_t>;
+
+// Largest differences between the original and the dequantized vertices
+struct QuantizationError {
+    std::size_t vertex_count{0};
+    float position{0.0f}; // In model units
+    float normal{0.0f}; // In degrees
+    float tex_coords{0.0f};
+};
+
+struct MeshStats {
+    WeldStats weld;
+    OptimizationStats optimization;
+    LodStats lods;
+    QuantizationError quantization;
+};
+
+void weld_mesh(ImportedMesh& mesh, WeldTolerance const& tolerance, WeldStats& stats)
+{
+    stats.vertex_count_before += mesh.vertices.size();
+    MeshOptimizer::weld_vertices(mesh.vertices, mesh.indices, tolerance);
+    stats.vertex_count_after += mesh.vertices.size();
+}
+
+void optimize_mesh(ImportedMesh& mesh, OptimizationStats& stats)
+{
+    auto const triangle_count = mesh.indices.size() / 3;
+    stats.triangle_count += triangle_count;
+    stats.transformed_vertices_before += MeshOptimizer::acmr(mesh.indices, mesh.vertices.size()) * triangle_count;
+
+    MeshOptimizer::optimize_vertex_cache(mesh.indices, mesh.vertices.size());
+    MeshOptimizer::optimize_vertex_fetch(mesh.vertices, mesh.indices);
+
+    stats.transformed_vertices_after += MeshOptimizer::acmr(mesh.indices, mesh.vertices.size()) * triangle_count;
+}
+
+void generate_lods(ImportedMesh& mesh, LodStats& stats)
+{
+    mesh.lods = MeshOptimizer::generate_lods(mesh.vertices, mesh.indices, mesh.aabb);
+    if (stats.size() < mesh.lods.size()) {
+        stats.resize(mesh.lods.size(), 0);
+    }
+    for (std::size_t level = 0; level < mesh.lods.size(); ++level) {
+        stats[level] += mesh.lods[level].index_count / 3;
+    }
 }
 
-std::optional<Node> ModelLoader::load_model(std::filesystem::path path)
+void quantize_mesh(ImportedMesh& mesh, QuantizationError& error)
 {
+    mesh.quantized_vertices.reserve(mesh.vertices.size());
+    for (auto const& vertex : mesh.vertices) {
+        auto const quantized = quantize_vertex(vertex, mesh.aabb);
+        auto const restored = dequantize_vertex(quantized, mesh.aabb);
+
+        error.position = std::max(error.position, glm::distance(vertex.m_position, restored.m_position));
+        error.tex_coords = std::max(error.tex_coords, glm::distance(vertex.m_tex_coords, restored.m_tex_coords));
+        if (glm::length(vertex.m_normal) > 0.0f) {
+            auto const cos_angle = glm::clamp(glm::dot(glm::normalize(vertex.m_normal), restored.m_normal), -1.0f, 1.0f);
+            error.normal = std::max(error.normal, glm::degrees(std::acos(cos_angle)));
+        }
+
+        mesh.quantized_vertices.push_back(quantized);
+    }
+
+    error.vertex_count += mesh.vertices.size();
+    mesh.vertices = {};
+}
+
+// Runs the enabled steps on a single mesh, so each mesh stays in the cache of one worker
+void process_imported_mesh(ImportedMesh& mesh, ImportOptions const& options, MeshStats& stats)
+{
+    if (options.weld_vertices) {
+        weld_mesh(mesh, options.weld_tolerance, stats.weld);
+    }
+
+    // Runs after welding, which changes the triangles that share vertices
+    if (options.optimize_meshes) {
+        optimize_mesh(mesh, stats.optimization);
+    }
+
+    // Runs after the vertex fetch optimisation, the LODs reuse the vertices of the full mesh
+    if (options.generate_lods) {
+        generate_lods(mesh, stats.lods);
+    }
+
+    // Must be the last step, the other steps work on float vertices
+    if (options.vertex_format == VertexFormat::QUANTIZED) {
+        quantize_mesh(mesh, stats.quantization);
+    }
+}
+
+void collect_meshes(ImportedNode& node, std::vector<ImportedMesh*>& meshes)
+{
+    for (auto& mesh : node.meshes) {
+        meshes.push_back(&mesh);
+    }
+
+    for (auto& child : node.children) {
+        collect_meshes(child, meshes);
+    }
+}
+
+MeshStats sum_stats(std::span<MeshStats const> mesh_stats)
+{
+    auto total = MeshStats{};
+    for (auto const& stats : mesh_stats) {
+        total.weld.vertex_count_before += stats.weld.vertex_count_before;
+        total.weld.vertex_count_after += stats.weld.vertex_count_after;
+
+        total.optimization.triangle_count += stats.optimization.triangle_count;
+        total.optimization.transformed_vertices_before += stats.optimization.transformed_vertices_before;
+        total.optimization.transformed_vertices_after += stats.optimization.transformed_vertices_after;
+
+        if (total.lods.size() < stats.lods.size()) {
+            total.lods.resize(stats.lods.size(), 0);
+        }
+        for (std::size_t level = 0; level < stats.lods.size(); ++level) {
+            total.lods[level] += stats.lods[level];
+        }
+
+        total.quantization.vertex_count += stats.quantization.vertex_count;
+        total.quantization.position = std::max(total.quantization.position, stats.quantization.position);
+        total.quantization.normal = std::max(total.quantization.normal, stats.quantization.normal);
+        total.quantization.tex_coords = std::max(total.quantization.tex_coords, stats.quantization.tex_coords);
+    }
+
+    return total;
+}
+
+// Forwards the progress of assimp, which is owned and deleted by the importer
+class ImportProgressHandler : public Assimp::ProgressHandler {
+public:
+    ImportProgressHandler(std::atomic<float>* progress)
+        : m_progress{progress}
+    { }
+
+    bool Update(float percentage) override
+    {
+        // Reading the file takes most of the time, the remaining share is left for converting the meshes
+        if (m_progress && percentage >= 0.0f) {
+            m_progress->store(percentage * 0.9f, std::memory_order_relaxed);
+        }
+
+        return true;
+    }
+
+private:
+    std::atomic<float>* m_progress;
+};
+
+// The cache is only invalidated by the model file. Textures that were missing when it was written are looked up
+// again, and the mask textures are taken from the current materials, so an edited `.mat` file is picked up.
+void resolve_cached_textures(ImportedMesh& mesh, std::filesystem::path const& directory)
+{
+    if (!mesh.unresolved_texture_diffuse.empty()) {
+        mesh.texture_diffuse = guess_texture_path(directory, mesh.unresolved_texture_diffuse);
+        if (mesh.texture_diffuse.has_value()) {
+            mesh.unresolved_texture_diffuse.clear();
+        }
+    }
+
+    mesh.texture_opacity = mesh.texture_diffuse.has_value()
+        ? find_mask_texture(mesh.texture_diffuse.value())
+        : std::nullopt;
+}
+
+std::optional<ImportedNode> ModelLoader::import_model(std::filesystem::path path, ImportOptions options, std::atomic<float>* progress)
+{
+    auto* project = Project::get_current();
+    assert(project != nullptr);
+
+    auto cache_file = MeshCache::cache_file(project->cache_directory(), path);
+    if (auto cached_node = MeshCache::load(cache_file, path, IMPORT_FLAGS, options); cached_node.has_value()) {
+        std::vector<ImportedMesh*> meshes;
+        collect_meshes(cached_node.value(), meshes);
+        for (auto* mesh : meshes) {
+            resolve_cached_textures(*mesh, path.parent_path());
+        }
+
+        if (progress) {
+            progress->store(1.0f, std::memory_order_relaxed);
+        }
+        return cached_node;
+    }
+
     Assimp::Importer importer;
-    aiScene const* scene = importer.ReadFile(path.string(), aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_GenBoundingBoxes);
+    importer.SetProgressHandler(new ImportProgressHandler{progress});
+    aiScene const* scene = importer.ReadFile(path.string(), IMPORT_FLAGS);
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
         return {};
@@ -307,6 +600,115 @@ std::optional<Node> ModelLoader::load_model(std::filesystem::path path)
 
     auto root_node_location = NodeLocation::file(path, "/");
 
-    // node processing seems off
-    return process_node(scene->mRootNode, scene, directory, root_node_location);
+    // Converts the meshes of all nodes on the background workers
+    auto root_node = process_node(scene->mRootNode, scene, directory, root_node_location);
+
+    std::vector<ImportedMesh*> meshes;
+    collect_meshes(root_node, meshes);
+
+    auto mesh_stats = std::vector<MeshStats>(meshes.size());
+    auto process_mesh_at = [&](std::size_t i) {
+        process_imported_mesh(*meshes[i], options, mesh_stats[i]);
+    };
+    AsyncTaskQueue::background.parallel_for(meshes.size(), process_mesh_at, AsyncTaskQueue::Priority::VISIBLE_NOW);
+
+    auto const stats = sum_stats(mesh_stats);
+
+    if (options.weld_vertices && stats.weld.vertex_count_before > 0) {
+        std::cout << "Welded " << stats.weld.vertex_count_before << " vertices of " << path
+                  << " into " << stats.weld.vertex_count_after
+                  << " (" << 100.0f * static_cast<float>(stats.weld.vertex_count_after) / static_cast<float>(stats.weld.vertex_count_before) << "%)\n";
+    }
+
+    if (options.optimize_meshes && stats.optimization.triangle_count > 0) {
+        auto const triangle_count = static_cast<float>(stats.optimization.triangle_count);
+        std::cout << "Optimized " << stats.optimization.triangle_count << " triangles of " << path
+                  << ", ACMR " << stats.optimization.transformed_vertices_before / triangle_count
+                  << " -> " << stats.optimization.transformed_vertices_after / triangle_count << "\n";
+    }
+
+    if (options.generate_lods) {
+        std::cout << "Generated LODs of " << path << ", triangles per LOD:";
+        for (auto triangle_count : stats.lods) {
+            std::cout << " " << triangle_count;
+        }
+        std::cout << "\n";
+    }
+
+    if (options.vertex_format == VertexFormat::QUANTIZED) {
+        std::cout << "Quantized " << stats.quantization.vertex_count << " vertices of " << path
+                  << ", max error: position " << stats.quantization.position
+                  << ", normal " << stats.quantization.normal << " deg"
+                  << ", texture coordinates " << stats.quantization.tex_coords << "\n";
+    }
+
+    MeshCache::store(cache_file, path, IMPORT_FLAGS, options, root_node);
+
+    if (progress) {
+        progress->store(1.0f, std::memory_order_relaxed);
+    }
+
+    return root_node;
+}
+
+Node ModelLoader::create_node(ImportedNode imported_node)
+{
+    auto* project = Project::get_current();
+    assert(project != nullptr);
+
+    auto new_node = Node::create(imported_node.name, imported_node.transform, imported_node.location);
+
+    for (auto& imported_mesh : imported_node.meshes) {
+        auto texture_diffuse = imported_mesh.texture_diffuse.has_value()
+            ? project->get_texture(imported_mesh.texture_diffuse.value())
+            : nullptr;
+        if (!texture_diffuse) {
+            texture_diffuse = project->fallback_texture();
+        }
+
+        auto texture_opacity = imported_mesh.texture_opacity.has_value()
+            ? project->get_texture(imported_mesh.texture_opacity.value())
+            : nullptr;
+        if (!texture_opacity) {
+            texture_opacity = project->white_texture();
+        }
+
+        if (imported_mesh.mapped_geometry.file) {
+            new_node.meshes.push_back(Mesh{
+                std::move(imported_mesh.mapped_geometry),
+                texture_diffuse,
+                texture_opacity,
+                imported_mesh.aabb,
+                std::move(imported_mesh.lods),
+            });
+            continue;
+        }
+
+        if (!imported_mesh.quantized_vertices.empty()) {
+            new_node.meshes.push_back(Mesh{
+                std::move(imported_mesh.quantized_vertices),
+                std::move(imported_mesh.indices),
+                texture_diffuse,
+                texture_opacity,
+                imported_mesh.aabb,
+                std::move(imported_mesh.lods),
+            });
+            continue;
+        }
+
+        new_node.meshes.push_back(Mesh{
+            std::move(imported_mesh.vertices),
+            std::move(imported_mesh.indices),
+            texture_diffuse,
+            texture_opacity,
+            imported_mesh.aabb,
+            std::move(imported_mesh.lods),
+        });
+    }
+
+    for (auto& child : imported_node.children) {
+        new_node.children.push_back(create_node(std::move(child)));
+    }
+
+    return new_node;
 }
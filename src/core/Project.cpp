@@ -3,8 +3,16 @@
 #include "core/AsyncTaskQueue.hpp"
 #include "core/ModelLoader.hpp"
 #include "core/Serializer.hpp"
+#include "core/TaskGraph.hpp"
+#include "core/TextureCache.hpp"
+#include "core/TextureCompressor.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <unordered_set>
+#include <utility>
 
 bool path_starts_with(std::filesystem::path path, std::filesystem::path prefix)
 {
@@ -87,6 +95,11 @@ Project::Project(std::filesystem::path root)
     rebuild_fs_cache();
 }
 
+std::filesystem::path Project::cache_directory() const
+{
+    return root / ".cache";
+}
+
 FSCacheNode* Project::get_fs_cache()
 {
     return m_fs_cache.get();
@@ -107,6 +120,7 @@ std::optional<std::filesystem::path> Project::get_fs_cache_from_guid(std::string
         return {};
     }
 
+    auto lock = std::lock_guard<std::mutex>{m_guid_mutex};
     if (auto it = m_guid_mappings.find(guid); it != m_guid_mappings.end()) {
         return it->second;
     }
@@ -114,7 +128,39 @@ std::optional<std::filesystem::path> Project::get_fs_cache_from_guid(std::string
     return {};
 }
 
-Texture const* Project::get_texture(std::filesystem::path path)
+std::string to_lower(std::string string)
+{
+    std::transform(string.begin(), string.end(), string.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return string;
+}
+
+std::vector<std::filesystem::path> Project::find_textures_by_filename(std::string const& filename) const
+{
+    auto const key = to_lower(filename);
+
+    auto lock = std::lock_guard<std::mutex>{m_texture_index_mutex};
+    if (auto it = m_texture_index.find(key); it != m_texture_index.end()) {
+        return it->second;
+    }
+
+    return {};
+}
+
+std::shared_ptr<UnityMaterial const> Project::get_unity_material(std::filesystem::path const& path) const
+{
+    auto const key = path.lexically_normal();
+
+    auto lock = std::lock_guard<std::mutex>{m_unity_materials_mutex};
+    if (auto it = m_unity_materials.find(key); it != m_unity_materials.end()) {
+        return it->second;
+    }
+
+    return nullptr;
+}
+
+Texture const* Project::get_texture(std::filesystem::path path, AsyncTaskQueue::Priority priority)
 {
     if (!path.is_absolute()) {
         std::cerr << "path " << path << " is not absolute";
@@ -122,36 +168,229 @@ Texture const* Project::get_texture(std::filesystem::path path)
     }
 
     if (m_textures.contains(path)) {
-        return &m_textures.at(path);
+        auto* texture = &m_textures.at(path);
+        texture->last_used_frame = m_frame;
+        request_texture(texture, priority);
+        return texture;
     }
 
     m_textures.emplace(path, Texture::fallback_placeholder(m_fallback_texture.id));
+    queue_texture_load(path, priority);
+
+    return &m_textures.at(path);
+}
+
+// Either a compressed image (from the cache or freshly compressed) or a raw one, if compression is off
+struct DecodedTexture {
+    std::optional<CompressedImage> compressed;
+    std::optional<Image> image;
+    // Holds the pixels once they are copied, nullptr if the upload reads them from RAM
+    std::shared_ptr<PixelBuffer> staging;
+};
+
+void Project::queue_texture_load(std::filesystem::path path, AsyncTaskQueue::Priority priority)
+{
     auto* texture = &m_textures.at(path);
 
-    if (!texture) {
-        return nullptr;
-    }
+    // Read on the main thread, the settings pane may change the config while the texture is loading.
+    // Without compression, the cache file is empty and the image is uploaded raw.
+    auto const cache_file = config.compress_textures && Texture::supports_compression()
+        ? TextureCache::cache_file(cache_directory(), path)
+        : std::filesystem::path{};
 
-    AsyncTaskQueue::background.push_task([path, texture]() {
-        auto new_image = Image::load_from_file(path.string().c_str());
+    // Passed between the stages
+    auto decoded = std::make_shared<DecodedTexture>();
 
-        AsyncTaskQueue::main.push_task([texture, path, new_image = std::move(new_image)]() mutable {
-            if (!new_image.has_value()) {
-                texture->is_loaded = true;
+    auto decode = [path, cache_file, decoded]() {
+        if (!cache_file.empty()) {
+            decoded->compressed = TextureCache::load(cache_file, path);
+            if (decoded->compressed.has_value()) {
                 return;
             }
+        }
 
-            auto new_texture = Texture::load_from_image(std::move(new_image.value()));
-            if (!new_texture.has_value()) {
-                texture->is_loaded = true;
-                return;
+        auto image = Image::load_from_file(path.string().c_str());
+        if (!image.has_value()) {
+            return;
+        }
+
+        if (cache_file.empty()) {
+            image->generate_mips();
+            decoded->image = std::move(image);
+            return;
+        }
+
+        decoded->compressed = TextureCompressor::compress(image.value());
+        TextureCache::store(cache_file, path, decoded->compressed.value());
+    };
+
+    // Mapping a pixel buffer needs the OpenGL context, filling it doesn't
+    auto stage = [this, decoded]() {
+        auto size = std::size_t{0};
+        if (decoded->compressed.has_value()) {
+            size = decoded->compressed->data.size();
+        } else if (decoded->image.has_value()) {
+            size = decoded->image->byte_size();
+        }
+
+        if (size > 0) {
+            decoded->staging = m_pixel_buffers.acquire(size);
+        }
+    };
+
+    // The pixels in RAM are released right away, the upload only needs the sizes
+    auto copy = [decoded]() {
+        if (!decoded->staging) {
+            return;
+        }
+
+        if (decoded->compressed.has_value()) {
+            auto& image = decoded->compressed.value();
+            std::memcpy(decoded->staging->mapping, image.data.data(), image.data.size());
+            image.data = {};
+            image.storage = nullptr;
+        } else if (decoded->image.has_value()) {
+            auto& image = decoded->image.value();
+            image.copy_to(decoded->staging->mapping);
+            image.data = {};
+            for (auto& mip : image.mips) {
+                mip.data = {};
             }
+        }
+    };
+
+    auto upload = [this, path, texture, decoded]() {
+        m_texture_loads.erase(texture);
+
+        auto new_texture = std::optional<Texture>{};
+        if (decoded->staging) {
+            if (m_pixel_buffers.bind_for_upload(*decoded->staging)) {
+                new_texture = decoded->compressed.has_value()
+                    ? Texture::load_from_pixel_buffer(decoded->compressed.value())
+                    : Texture::load_from_pixel_buffer(decoded->image.value());
+            } else {
+                std::cerr << "Lost the pixel buffer of texture " << path << "\n";
+            }
+            m_pixel_buffers.finish_upload(*decoded->staging);
+            decoded->staging = nullptr;
+        } else if (decoded->compressed.has_value()) {
+            new_texture = Texture::load_from_compressed(decoded->compressed.value());
+        } else if (decoded->image.has_value()) {
+            new_texture = Texture::load_from_image(std::move(decoded->image.value()));
+        }
+
+        if (!new_texture.has_value()) {
+            texture->is_loaded = true;
+            return;
+        }
+
+        // Requested in this frame, so it isn't evicted right away
+        new_texture->last_used_frame = m_frame;
+        *texture = std::move(new_texture.value());
+        m_texture_memory += texture->memory_size;
+    };
+
+    auto graph = TaskGraph{priority};
+    auto decode_id = graph.add(AsyncTaskQueue::background, std::move(decode));
+    auto stage_id = graph.add(AsyncTaskQueue::main, std::move(stage), {decode_id});
+    auto copy_id = graph.add(AsyncTaskQueue::background, std::move(copy), {stage_id});
+    graph.add(AsyncTaskQueue::main, std::move(upload), {copy_id});
+    graph.submit();
+
+    m_texture_loads.insert_or_assign(texture, TextureLoad{.path = path, .graph = graph});
+}
+
+void Project::request_texture(Texture const* texture, AsyncTaskQueue::Priority priority)
+{
+    auto it = m_texture_loads.find(texture);
+    if (it == m_texture_loads.end()) {
+        return;
+    }
+
+    auto& load = it->second;
+    if (load.graph.is_cancelled()) {
+        queue_texture_load(load.path, priority);
+        return;
+    }
+
+    load.graph.set_priority(priority);
+}
 
-            *texture = std::move(new_texture.value());
+void Project::release_textures(InstancedNode const& removed_node)
+{
+    if (m_texture_loads.empty()) {
+        return;
+    }
+
+    std::unordered_set<Texture const*> unused_textures;
+    removed_node.traverse([&](glm::mat4, Node const& node) {
+        for (auto const& mesh : node.meshes) {
+            for (auto texture : {mesh.m_texture_diffuse, mesh.m_texture_opacity}) {
+                if (m_texture_loads.contains(texture)) {
+                    unused_textures.insert(texture);
+                }
+            }
+        }
+    });
+
+    if (unused_textures.empty()) {
+        return;
+    }
+
+    // Textures might be shared with other instances that are still part of the scene
+    if (scene) {
+        scene->traverse([&](glm::mat4, Node const& node) {
+            for (auto const& mesh : node.meshes) {
+                unused_textures.erase(mesh.m_texture_diffuse);
+                unused_textures.erase(mesh.m_texture_opacity);
+            }
         });
+    }
+
+    // The entries are kept, so the load can be restarted by `request_texture`
+    for (auto texture : unused_textures) {
+        m_texture_loads.at(texture).graph.cancel();
+    }
+}
+
+void Project::evict_textures()
+{
+    auto const budget = static_cast<std::size_t>(static_cast<double>(config.texture_memory_budget) * 1024.0 * 1024.0);
+    if (budget == 0 || m_texture_memory <= budget) {
+        return;
+    }
+
+    // Textures that were drawn in the last frames are kept even if that stays over budget, evicting them would only
+    // load them again right away
+    auto const keep_frames = std::uint64_t{2};
+    std::vector<std::pair<std::filesystem::path const*, Texture*>> candidates;
+    for (auto& [path, texture] : m_textures) {
+        if (texture.is_loaded && texture.memory_size > 0 && texture.last_used_frame + keep_frames < m_frame) {
+            candidates.emplace_back(&path, &texture);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](auto const& a, auto const& b) {
+        return a.second->last_used_frame < b.second->last_used_frame;
     });
 
-    return texture;
+    for (auto const& [path, texture] : candidates) {
+        if (m_texture_memory <= budget) {
+            break;
+        }
+
+        // The placeholder keeps the address of the texture, the meshes point to it.
+        // The GL texture is deleted with `evicted`.
+        auto evicted = std::exchange(*texture, Texture::fallback_placeholder(m_fallback_texture.id));
+        texture->last_used_frame = evicted.last_used_frame;
+        m_texture_memory -= evicted.memory_size;
+        ++m_evicted_textures;
+
+        // A cancelled load is restarted by `request_texture` once the texture is used again
+        auto graph = TaskGraph{};
+        graph.cancel();
+        m_texture_loads.insert_or_assign(texture, TextureLoad{.path = *path, .graph = graph});
+    }
 }
 
 Node* Project::get_model(std::filesystem::path path)
@@ -165,13 +404,278 @@ Node* Project::get_model(std::filesystem::path path)
         return &m_models.at(path);
     }
 
-    auto new_model = ModelLoader::load_model(path);
-    if (!new_model.has_value()) {
+    // The placeholder is named after the file, like the root node of an instantiated model
+    auto filename = path.filename().string();
+    auto placeholder = Node::create(filename, Transform{}, NodeLocation::file(path, "/" + filename));
+    placeholder.is_loading = true;
+
+    auto* model = &m_models.emplace(path, std::move(placeholder)).first->second;
+    queue_model_load(path, model);
+
+    return model;
+}
+
+void collect_meshes(Node& node, std::vector<Mesh*>& meshes)
+{
+    for (auto& mesh : node.meshes) {
+        meshes.push_back(&mesh);
+    }
+
+    for (auto& child : node.children) {
+        collect_meshes(child, meshes);
+    }
+}
+
+// Instances that were created from the placeholder only contain the root node
+void attach_loaded_model(InstancedNode& instance, Node const& model)
+{
+    if (instance.node == &model) {
+        // Keep changes to the transform that were made while the model was loading
+        auto& transform = instance.transform;
+        transform.position += transform.orientation * (transform.scale * model.transform.position);
+        transform.orientation = transform.orientation * model.transform.orientation;
+        transform.scale *= model.transform.scale;
+
+        for (auto const& child : model.children) {
+            instance.children.push_back(child.instantiate());
+        }
+        return;
+    }
+
+    for (auto& child : instance.children) {
+        attach_loaded_model(*child, model);
+    }
+}
+
+void Project::queue_model_load(std::filesystem::path path, Node* model)
+{
+    // Passed from the import to the main thread stages
+    auto imported = std::make_shared<std::optional<ImportedNode>>();
+    auto import_progress = std::make_shared<std::atomic<float>>(0.0f);
+
+    // Read on the main thread, the settings pane may change the config while the import is running
+    auto const options = ImportOptions{
+        .vertex_format = config.quantize_vertices ? VertexFormat::QUANTIZED : VertexFormat::FLOAT,
+        .weld_vertices = config.weld_vertices,
+        .weld_tolerance = {
+            .position = std::max(config.weld_position_epsilon, 0.0f),
+            .normal = std::max(config.weld_normal_epsilon, 0.0f),
+            .tex_coords = std::max(config.weld_tex_coords_epsilon, 0.0f),
+        },
+        .optimize_meshes = config.optimize_meshes,
+        .generate_lods = config.generate_lods,
+    };
+
+    auto import = [path, options, imported, import_progress]() {
+        *imported = ModelLoader::import_model(path, options, import_progress.get());
+    };
+
+    auto finish = [this, model]() {
+        m_model_loads.erase(model);
+    };
+
+    // The user is waiting for the model, so it takes precedence over textures that are not in view
+    auto graph = TaskGraph{AsyncTaskQueue::Priority::VISIBLE_NOW};
+    auto import_id = graph.add(AsyncTaskQueue::background, std::move(import));
+    auto finish_id = graph.add(AsyncTaskQueue::main, std::move(finish), {import_id});
+
+    auto create_meshes = [this, path, model, imported, graph, finish_id]() mutable {
+        if (!imported->has_value()) {
+            std::cerr << "Failed to load model " << path << "\n";
+            model->is_loading = false;
+            return;
+        }
+
+        *model = ModelLoader::create_node(std::move(imported->value()));
+        imported->reset();
+
+        if (scene) {
+            attach_loaded_model(*scene, *model);
+            scene->compute_transforms();
+        }
+
+        // Every mesh gets its own upload task, so a large model is uploaded over multiple frames
+        std::vector<Mesh*> meshes;
+        collect_meshes(*model, meshes);
+
+        auto& load = m_model_loads.at(model);
+        load.meshes_total = meshes.size();
+
+        for (auto* mesh : meshes) {
+            auto upload = [this, model, mesh]() {
+                mesh->setup_mesh(config.keep_mesh_data);
+                ++m_model_loads.at(model).meshes_uploaded;
+            };
+            graph.add_dependency(finish_id, graph.add(AsyncTaskQueue::main, std::move(upload)));
+        }
+    };
+
+    auto create_meshes_id = graph.add(AsyncTaskQueue::main, std::move(create_meshes), {import_id});
+    graph.add_dependency(finish_id, create_meshes_id);
+
+    m_model_loads.insert_or_assign(model,
+        ModelLoad{
+            .graph = graph,
+            .import_progress = import_progress,
+            .meshes_total = 0,
+            .meshes_uploaded = 0,
+        });
+    graph.submit();
+}
+
+bool is_subtree_loaded(InstancedNode const& root)
+{
+    auto is_loaded = true;
+    root.traverse([&](glm::mat4, Node const& node) {
+        is_loaded = is_loaded && !node.is_loading;
+        for (auto const& mesh : node.meshes) {
+            is_loaded = is_loaded && mesh.is_fully_loaded();
+        }
+    });
+
+    return is_loaded;
+}
+
+HlodProxy const* Project::get_hlod_proxy(InstancedNode const& node)
+{
+    auto& entry = m_hlod_proxies[node.id];
+    entry.last_used = m_current_time;
+
+    if (entry.proxy && entry.proxy->subtree_hash == node.subtree_hash) {
+        return entry.proxy.get();
+    }
+
+    auto const is_building = entry.build && !entry.build->is_cancelled() && !entry.build->is_finished();
+    if (is_building && entry.build_subtree_hash == node.subtree_hash) {
         return nullptr;
     }
 
-    m_models.emplace(path, new_model.value());
-    return &m_models.at(path);
+    // The average colors of the textures are baked into the proxy, so everything must be loaded
+    if (m_current_time < entry.retry_time) {
+        return nullptr;
+    }
+    if (!is_subtree_loaded(node)) {
+        entry.retry_time = m_current_time + 1.0;
+        return nullptr;
+    }
+
+    // A child changed while the previous build was running
+    if (is_building) {
+        entry.build->cancel();
+    }
+
+    queue_hlod_build(node);
+    return nullptr;
+}
+
+void Project::queue_hlod_build(InstancedNode const& node)
+{
+    // Passed from the collect to the build and upload stages
+    auto source = std::make_shared<std::optional<HlodSource>>();
+    auto geometry = std::make_shared<std::optional<HlodGeometry>>();
+
+    auto const node_id = node.id;
+    auto const subtree_hash = node.subtree_hash;
+    // Proxies cover at most `hlod_pixel_size` pixels, so the error stays below `lod_pixel_error` pixels
+    auto const target_error = config.lod_pixel_error / config.hlod_pixel_size;
+
+    auto build = [source, geometry, target_error]() {
+        if (source->has_value()) {
+            *geometry = HlodBuilder::build(std::move(source->value()), target_error);
+            source->reset();
+        }
+    };
+
+    auto upload = [this, node_id, subtree_hash, geometry]() {
+        auto it = m_hlod_proxies.find(node_id);
+        if (it == m_hlod_proxies.end() || !geometry->has_value()) {
+            return;
+        }
+
+        // The previous proxy stays until the new one is ready, it's only drawn while it's up to date
+        if (auto proxy = HlodBuilder::create_proxy(std::move(geometry->value()), white_texture(), subtree_hash)) {
+            it->second.proxy = std::move(proxy);
+        }
+    };
+
+    // Proxies only replace subtrees that are drawn already, so they wait for the textures in view
+    auto graph = TaskGraph{AsyncTaskQueue::Priority::VISIBLE_SOON};
+    auto build_id = graph.add(AsyncTaskQueue::background, std::move(build));
+    graph.add(AsyncTaskQueue::main, std::move(upload), {build_id});
+
+    auto collect = [this, node_id, subtree_hash, source, graph, build_id]() mutable {
+        // The node might have been removed or changed since the build was queued
+        auto const* node = scene ? scene->find(node_id) : nullptr;
+        if (!node || node->subtree_hash != subtree_hash || !is_subtree_loaded(*node)) {
+            return;
+        }
+
+        *source = HlodBuilder::collect(*node);
+
+        // Every readback gets its own task, so the main thread budget applies to them. Meshes with a CPU copy or
+        // a mapped cache file are read in the background.
+        for (std::size_t i = 0; i < source->value().meshes.size(); ++i) {
+            auto& queue = source->value().meshes[i].mesh->needs_readback() ? AsyncTaskQueue::main : AsyncTaskQueue::background;
+            auto read_geometry = [source, i]() {
+                HlodBuilder::read_geometry(source->value().meshes[i]);
+            };
+            graph.add_dependency(build_id, graph.add(queue, std::move(read_geometry)));
+        }
+
+        for (std::size_t cell = 0; cell < source->value().textures.size(); ++cell) {
+            auto read_color = [source, cell]() {
+                HlodBuilder::read_color(source->value(), cell);
+            };
+            graph.add_dependency(build_id, graph.add(AsyncTaskQueue::main, std::move(read_color)));
+        }
+    };
+
+    graph.add_dependency(build_id, graph.add(AsyncTaskQueue::main, std::move(collect)));
+    graph.submit();
+
+    auto& entry = m_hlod_proxies.at(node_id);
+    entry.build = graph;
+    entry.build_subtree_hash = subtree_hash;
+}
+
+std::optional<float> Project::model_load_progress(Node const* model) const
+{
+    auto it = m_model_loads.find(model);
+    if (it == m_model_loads.end()) {
+        return {};
+    }
+
+    // Importing takes most of the time, the uploads are only the last few percent
+    auto const& load = it->second;
+    auto const import_progress = load.import_progress->load(std::memory_order_relaxed);
+    auto const upload_progress = load.meshes_total > 0
+        ? static_cast<float>(load.meshes_uploaded) / static_cast<float>(load.meshes_total)
+        : 0.0f;
+
+    return 0.9f * import_progress + 0.1f * upload_progress;
+}
+
+std::size_t Project::num_model_loads() const
+{
+    return m_model_loads.size();
+}
+
+void Project::wait_for_models()
+{
+    while (true) {
+        // Cancelled loads never finish
+        std::erase_if(m_model_loads, [](auto const& item) {
+            auto const& graph = item.second.graph;
+            return graph.is_cancelled() || graph.is_finished();
+        });
+        if (m_model_loads.empty()) {
+            return;
+        }
+
+        // The other stages run in the background and queue the next main thread stage once they finished
+        AsyncTaskQueue::main.wait_for_tasks();
+        AsyncTaskQueue::main.run();
+    }
 }
 
 Node* Project::get_cached_model(std::filesystem::path path)
@@ -310,93 +814,251 @@ std::optional<std::string> get_unity_guid(std::filesystem::path path)
     return {};
 }
 
-void Project::rebuild_fs_cache_helper(FSCacheNode& cache_node)
+// Scans the directory at `path`. The entries of `previous` are reused if the directory didn't change,
+// subdirectories are scanned in parallel.
+FSCacheNode scan_directory(std::filesystem::path const& path, FSCacheNode const* previous, std::filesystem::path const& cache_directory)
 {
-    if (!std::filesystem::is_directory(cache_node.path)) {
-        return;
-    }
+    auto node = FSCacheNode{
+        .path = path,
+        .mtime = std::filesystem::last_write_time(path),
+        .type = FSCacheNode::Type::DIRECTORY,
+        .children = {},
+        .unity_guid = {},
+    };
+
+    // Previous entries of the subdirectories, matched by index with `node.children`
+    std::vector<FSCacheNode const*> previous_subdirectories;
+
+    if (previous && previous->mtime == node.mtime) {
+        for (auto const& child : previous->children) {
+            if (child.type == FSCacheNode::Type::DIRECTORY) {
+                node.children.push_back(FSCacheNode{
+                    .path = child.path,
+                    .mtime = {},
+                    .type = FSCacheNode::Type::DIRECTORY,
+                    .children = {},
+                    .unity_guid = {},
+                });
+                previous_subdirectories.push_back(&child);
+            } else {
+                node.children.push_back(child);
+                previous_subdirectories.push_back(nullptr);
+            }
+        }
+    } else {
+        std::unordered_map<std::filesystem::path, FSCacheNode const*> previous_children;
+        if (previous) {
+            for (auto const& child : previous->children) {
+                previous_children.emplace(child.path, &child);
+            }
+        }
 
-    auto const mtime = std::filesystem::last_write_time(cache_node.path);
-    if (cache_node.mtime == mtime) {
-        for (auto& child : cache_node.children) {
-            rebuild_fs_cache_helper(child);
+        for (auto& entry : std::filesystem::directory_iterator{path}) {
+            if (entry.path() == cache_directory) {
+                continue;
+            }
+
+            auto const file_type = identify_file(entry.path());
+            auto& new_node = node.children.emplace_back(FSCacheNode{
+                .path = entry.path(),
+                .mtime = file_type == FSCacheNode::Type::DIRECTORY
+                    ? std::filesystem::file_time_type{}
+                    : std::filesystem::last_write_time(entry.path()),
+                .type = file_type,
+                .children = {},
+                .unity_guid = {},
+            });
+
+            if (file_type == FSCacheNode::Type::TEXTURE) {
+                new_node.unity_guid = get_unity_guid(entry.path());
+            }
+
+            auto it = previous_children.find(entry.path());
+            auto const is_previous_directory = it != previous_children.end() && it->second->type == FSCacheNode::Type::DIRECTORY;
+            previous_subdirectories.push_back(is_previous_directory ? it->second : nullptr);
         }
-        return;
     }
 
-    cache_node.mtime = mtime;
-    cache_node.children.clear();
+    auto scan_subdirectory = [&](std::size_t i) {
+        auto& child = node.children[i];
+        if (child.type != FSCacheNode::Type::DIRECTORY) {
+            return;
+        }
 
-    for (auto& entry : std::filesystem::directory_iterator{cache_node.path}) {
-        auto const file_type = identify_file(entry.path());
+        // Exceptions must not escape the tasks. The directory stays empty until the next scan.
+        try {
+            child = scan_directory(child.path, previous_subdirectories[i], cache_directory);
+        } catch (std::exception const& e) {
+            std::cerr << "Failed to scan " << child.path << ": " << e.what() << "\n";
+        }
+    };
+    AsyncTaskQueue::background.parallel_for(node.children.size(), scan_subdirectory, AsyncTaskQueue::Priority::PREFETCH);
 
-        auto& new_node = cache_node.children.emplace_back(FSCacheNode{
-            .path = entry.path(),
-            .mtime = file_type == FSCacheNode::Type::DIRECTORY
-                ? std::filesystem::file_time_type{}
-                : std::filesystem::last_write_time(entry.path()),
-            .type = file_type,
-            .children = {},
-        });
+    return node;
+}
 
-        if (file_type == FSCacheNode::Type::TEXTURE) {
-            auto unity_guid = get_unity_guid(entry.path());
-            if (unity_guid.has_value()) {
-                m_guid_mappings[unity_guid.value()] = entry.path();
-            }
+void collect_fs_cache_entries(FSCacheNode const& cache_node,
+    std::unordered_map<std::string, std::filesystem::path>& guid_mappings,
+    std::unordered_map<std::string, std::vector<std::filesystem::path>>& texture_index,
+    std::vector<FSCacheNode const*>& materials)
+{
+    if (cache_node.type == FSCacheNode::Type::TEXTURE) {
+        if (cache_node.unity_guid.has_value()) {
+            guid_mappings[cache_node.unity_guid.value()] = cache_node.path;
         }
+        texture_index[to_lower(cache_node.path.filename().string())].push_back(cache_node.path.lexically_normal());
+    }
 
-        if (file_type == FSCacheNode::Type::DIRECTORY) {
-            rebuild_fs_cache_helper(new_node);
-        }
+    if (cache_node.type == FSCacheNode::Type::UNITY_MATERIAL) {
+        materials.push_back(&cache_node);
+    }
+
+    for (auto const& child : cache_node.children) {
+        collect_fs_cache_entries(child, guid_mappings, texture_index, materials);
     }
 }
 
-void Project::rebuild_fs_cache()
+Project::FSCacheSnapshot Project::scan_fs_cache() const
 {
+    auto snapshot = FSCacheSnapshot{};
     if (!std::filesystem::is_directory(root)) {
         std::cerr << "Invalid project root path '" << root << "'\n";
-        m_fs_cache = {};
-        return;
+        return snapshot;
     }
 
-    if (!m_fs_cache) {
-        m_fs_cache = std::make_unique<FSCacheNode>(FSCacheNode{
-            .path = root,
-            .mtime = {},
-            .type = FSCacheNode::Type::DIRECTORY,
-            .children = {},
-        });
+    snapshot.root = std::make_unique<FSCacheNode>(scan_directory(root, m_fs_cache.get(), cache_directory()));
+
+    std::vector<FSCacheNode const*> material_nodes;
+    collect_fs_cache_entries(*snapshot.root, snapshot.guid_mappings, snapshot.texture_index, material_nodes);
+
+    // Only materials that are new or changed are parsed again
+    std::vector<FSCacheNode const*> changed_nodes;
+    {
+        auto lock = std::lock_guard<std::mutex>{m_unity_materials_mutex};
+        for (auto const* node : material_nodes) {
+            auto key = node->path.lexically_normal();
+            if (auto it = m_unity_materials.find(key); it != m_unity_materials.end() && it->second->mtime == node->mtime) {
+                snapshot.unity_materials.emplace(std::move(key), it->second);
+            } else {
+                changed_nodes.push_back(node);
+            }
+        }
+    }
+
+    auto parsed = std::vector<std::shared_ptr<UnityMaterial const>>(changed_nodes.size());
+    auto parse_material = [&](std::size_t i) {
+        if (auto material = UnityMaterial::parse(changed_nodes[i]->path, changed_nodes[i]->mtime); material.has_value()) {
+            parsed[i] = std::make_shared<UnityMaterial const>(std::move(material.value()));
+        }
+    };
+    AsyncTaskQueue::background.parallel_for(changed_nodes.size(), parse_material, AsyncTaskQueue::Priority::PREFETCH);
+
+    for (std::size_t i = 0; i < changed_nodes.size(); ++i) {
+        if (parsed[i]) {
+            snapshot.unity_materials.emplace(changed_nodes[i]->path.lexically_normal(), std::move(parsed[i]));
+        }
+    }
+
+    if (!changed_nodes.empty()) {
+        std::cout << "Parsed " << changed_nodes.size() << " of " << material_nodes.size() << " Unity materials\n";
+    }
+
+    return snapshot;
+}
+
+void Project::apply_fs_cache(FSCacheSnapshot snapshot)
+{
+    m_fs_cache = std::move(snapshot.root);
+
+    // Imports read these on background threads
+    {
+        auto lock = std::lock_guard<std::mutex>{m_guid_mutex};
+        m_guid_mappings = std::move(snapshot.guid_mappings);
+    }
+    {
+        auto lock = std::lock_guard<std::mutex>{m_texture_index_mutex};
+        m_texture_index = std::move(snapshot.texture_index);
+    }
+    {
+        auto lock = std::lock_guard<std::mutex>{m_unity_materials_mutex};
+        m_unity_materials = std::move(snapshot.unity_materials);
     }
+}
+
+void Project::rebuild_fs_cache()
+{
+    apply_fs_cache(scan_fs_cache());
+}
+
+void Project::queue_fs_scan()
+{
+    // The whole scan runs in the background, the main thread only swaps in the result
+    auto snapshot = std::make_shared<std::optional<FSCacheSnapshot>>();
+
+    auto scan = [this, snapshot]() {
+        try {
+            if (m_fs_cache && is_fs_cache_valid(*m_fs_cache)) {
+                return;
+            }
+
+            *snapshot = scan_fs_cache();
+        } catch (std::exception const& e) {
+            // E.g. a directory that was removed during the scan, the next scan picks up the changes
+            std::cerr << "Failed to scan the project files: " << e.what() << "\n";
+        }
+    };
+
+    auto apply = [this, snapshot]() {
+        if (snapshot->has_value()) {
+            apply_fs_cache(std::move(snapshot->value()));
+            snapshot->reset();
+        }
+    };
 
-    rebuild_fs_cache_helper(*m_fs_cache);
+    auto graph = TaskGraph{AsyncTaskQueue::Priority::PREFETCH};
+    auto scan_id = graph.add(AsyncTaskQueue::background, std::move(scan));
+    graph.add(AsyncTaskQueue::main, std::move(apply), {scan_id});
+    graph.submit();
+    m_fs_scan = graph;
 }
 
 void Project::update(double current_time)
 {
+    m_current_time = current_time;
+    ++m_frame;
+    m_pixel_buffers.collect();
+    evict_textures();
+
+    // Proxies of removed nodes and of subtrees that are close to the camera are not drawn anymore
+    auto const hlod_unused_time = 10.0;
+    std::erase_if(m_hlod_proxies, [&](auto const& item) {
+        auto const& entry = item.second;
+        auto const is_building = entry.build && !entry.build->is_cancelled() && !entry.build->is_finished();
+        return !is_building && current_time - entry.last_used > hlod_unused_time;
+    });
+
     auto const update_interval = 5.0;
     if (current_time - m_fs_cache_last_updated < update_interval) {
         return;
     }
 
-    AsyncTaskQueue::background.push_task([this, current_time] {
-        m_fs_cache_last_updated = current_time;
-
-        if (is_fs_cache_valid(*m_fs_cache)) {
-            return;
-        }
+    m_fs_cache_last_updated = current_time;
 
-        AsyncTaskQueue::main.push_task([this] {
-            std::cout << "fs cache update in foreground\n";
-            rebuild_fs_cache();
-        });
-    });
+    // Only one scan at a time, it reads the current snapshot
+    if (!m_fs_scan || m_fs_scan->is_finished()) {
+        queue_fs_scan();
+    }
 
     if (config.fallback_color != glm::vec3{m_fallback_texture.color()}) {
         m_fallback_texture.color(glm::vec4{config.fallback_color, 1.0f});
     }
 }
 
+std::uint64_t Project::frame() const
+{
+    return m_frame;
+}
+
 Texture const* Project::fallback_texture() const
 {
     return &m_fallback_texture;
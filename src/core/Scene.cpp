@@ -31,6 +31,7 @@ Node Node::create(std::string name, Transform transform, NodeLocation location)
         .meshes = {},
         .name = name,
         .location = location,
+        .is_loading = false,
     };
 }
 
@@ -53,6 +54,10 @@ std::unique_ptr<InstancedNode> Node::instantiate() const
 
 [[nodiscard]] bool Node::is_fully_loaded() const
 {
+    if (is_loading) {
+        return false;
+    }
+
     for (auto const& mesh : meshes) {
         if (!mesh.is_fully_loaded()) {
             return false;
@@ -79,11 +84,53 @@ void InstancedNode::traverse(std::function<void(glm::mat4, Node const&)> f) cons
     }
 }
 
+void hash_combine(std::size_t& seed, std::size_t value)
+{
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+std::size_t hash_transform(Transform const& transform)
+{
+    auto seed = std::size_t{0};
+    for (int i = 0; i < 3; ++i) {
+        hash_combine(seed, std::hash<float>{}(transform.position[i]));
+        hash_combine(seed, std::hash<float>{}(transform.scale[i]));
+    }
+    for (int i = 0; i < 4; ++i) {
+        hash_combine(seed, std::hash<float>{}(transform.orientation[i]));
+    }
+    return seed;
+}
+
 void InstancedNode::compute_transforms(glm::mat4 parent_transform)
 {
     model_matrix = parent_transform * transform.get_local_matrix();
+
+    bounds = {};
+    mesh_count = 0;
+    subtree_hash = std::hash<Node const*>{}(node);
+
+    if (node) {
+        for (auto const& mesh : node->meshes) {
+            auto const mesh_bounds = mesh.aabb.transformed(model_matrix);
+            bounds = bounds ? bounds->merge(mesh_bounds) : mesh_bounds;
+        }
+        mesh_count = node->meshes.size();
+        hash_combine(subtree_hash, mesh_count);
+    }
+
     for (auto& child : children) {
         child->compute_transforms(model_matrix);
+
+        if (child->bounds) {
+            bounds = bounds ? bounds->merge(*child->bounds) : *child->bounds;
+        }
+        mesh_count += child->mesh_count;
+
+        // Proxies are built in the space of this node, so only the transforms of the children matter
+        hash_combine(subtree_hash, child->id);
+        hash_combine(subtree_hash, hash_transform(child->transform));
+        hash_combine(subtree_hash, child->subtree_hash);
     }
 }
 
@@ -102,6 +149,21 @@ InstancedNode* InstancedNode::find_parent(InstancedNode& scene) const
     return nullptr;
 }
 
+InstancedNode const* InstancedNode::find(unsigned int node_id) const
+{
+    if (id == node_id) {
+        return this;
+    }
+
+    for (auto const& child : children) {
+        if (auto found = child->find(node_id)) {
+            return found;
+        }
+    }
+
+    return nullptr;
+}
+
 NodeLocation NodeLocation::empty()
 {
     return NodeLocation{
@@ -13,6 +13,12 @@ void Serializer::serialize(InstancedNode const& source, std::ostream& target) co
 std::unique_ptr<InstancedNode> Serializer::deserialize_scene(std::istream& source) const
 {
     auto json = nlohmann::json::parse(source);
+
+    // Start importing all models at once, so they are loaded in parallel.
+    // The nodes can only be resolved once the models are loaded.
+    request_models(json);
+    m_project.wait_for_models();
+
     return deserialize_unique_ptr_instancednode(json);
 }
 
@@ -61,6 +67,8 @@ nlohmann::json Serializer::serialize(Config const& source) const
     target["fov"] = source.fov;
     target["near"] = source.near;
     target["far"] = source.far;
+    target["lod_pixel_error"] = source.lod_pixel_error;
+    target["hlod_pixel_size"] = source.hlod_pixel_size;
     target["camera_controller_type"] = source.camera_controller_type;
     target["movement_speed"] = source.movement_speed;
     target["rotation_speed"] = source.rotation_speed;
@@ -71,6 +79,17 @@ nlohmann::json Serializer::serialize(Config const& source) const
     target["gizmo_snap_translation"] = source.gizmo_snap_translation;
     target["gizmo_snap_rotation"] = source.gizmo_snap_rotation;
     target["gizmo_snap_scale"] = source.gizmo_snap_scale;
+    target["main_thread_budget"] = source.main_thread_budget;
+    target["keep_mesh_data"] = source.keep_mesh_data;
+    target["compress_textures"] = source.compress_textures;
+    target["texture_memory_budget"] = source.texture_memory_budget;
+    target["quantize_vertices"] = source.quantize_vertices;
+    target["weld_vertices"] = source.weld_vertices;
+    target["weld_position_epsilon"] = source.weld_position_epsilon;
+    target["weld_normal_epsilon"] = source.weld_normal_epsilon;
+    target["weld_tex_coords_epsilon"] = source.weld_tex_coords_epsilon;
+    target["optimize_meshes"] = source.optimize_meshes;
+    target["generate_lods"] = source.generate_lods;
     return target;
 }
 
@@ -119,8 +138,23 @@ std::unique_ptr<InstancedNode> Serializer::deserialize_unique_ptr_instancednode(
     });
 }
 
+void Serializer::request_models(nlohmann::json& source) const
+{
+    if (source["has_file"]) {
+        auto project_root = Project::get_current()->root;
+        m_project.get_model(project_root / static_cast<std::filesystem::path>(static_cast<std::string>(source["file_path"])));
+    }
+
+    for (auto& child : source["children"]) {
+        request_models(child);
+    }
+}
+
 Config Serializer::deserialize_config(nlohmann::json& source) const
 {
+    // Settings that were added later fall back to their default, so older project files can still be loaded
+    auto const defaults = Config{};
+
     return Config{
         .viewing_mode = source["viewing_mode"],
         .viewport_uniforms = deserialize_uniforms(source["viewport_uniforms"]),
@@ -129,6 +163,8 @@ Config Serializer::deserialize_config(nlohmann::json& source) const
         .fov = source["fov"],
         .near = source["near"],
         .far = source["far"],
+        .lod_pixel_error = source.value("lod_pixel_error", defaults.lod_pixel_error),
+        .hlod_pixel_size = source.value("hlod_pixel_size", defaults.hlod_pixel_size),
         .camera_controller_type = source["camera_controller_type"],
         .movement_speed = source["movement_speed"],
         .rotation_speed = source["rotation_speed"],
@@ -139,6 +175,17 @@ Config Serializer::deserialize_config(nlohmann::json& source) const
         .gizmo_snap_translation = source["gizmo_snap_translation"],
         .gizmo_snap_rotation = source["gizmo_snap_rotation"],
         .gizmo_snap_scale = source["gizmo_snap_scale"],
+        .main_thread_budget = source.value("main_thread_budget", defaults.main_thread_budget),
+        .keep_mesh_data = source.value("keep_mesh_data", defaults.keep_mesh_data),
+        .compress_textures = source.value("compress_textures", defaults.compress_textures),
+        .texture_memory_budget = source.value("texture_memory_budget", defaults.texture_memory_budget),
+        .quantize_vertices = source.value("quantize_vertices", defaults.quantize_vertices),
+        .weld_vertices = source.value("weld_vertices", defaults.weld_vertices),
+        .weld_position_epsilon = source.value("weld_position_epsilon", defaults.weld_position_epsilon),
+        .weld_normal_epsilon = source.value("weld_normal_epsilon", defaults.weld_normal_epsilon),
+        .weld_tex_coords_epsilon = source.value("weld_tex_coords_epsilon", defaults.weld_tex_coords_epsilon),
+        .optimize_meshes = source.value("optimize_meshes", defaults.optimize_meshes),
+        .generate_lods = source.value("generate_lods", defaults.generate_lods),
     };
 }
 
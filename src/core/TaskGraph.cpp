@@ -0,0 +1,190 @@
+#include "core/TaskGraph.hpp"
+
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+// Graphs are small (a handful of stages, or one task per texture of a model),
+// so a single mutex guards all nodes of a graph.
+struct TaskGraph::State : std::enable_shared_from_this<TaskGraph::State> {
+    struct Node {
+        Task task;
+        AsyncTaskQueue* queue;
+        // Join counter, the node is started once it reaches zero
+        std::size_t pending_dependencies{0};
+        std::vector<NodeId> successors;
+        AsyncTaskQueue::TaskHandle handle;
+        bool is_started{false};
+        bool is_finished{false};
+    };
+
+    mutable std::mutex mutex;
+    // A deque, so nodes don't move when tasks are added while others are running
+    std::deque<Node> nodes;
+    std::size_t unfinished_nodes{0};
+    AsyncTaskQueue::Priority priority;
+    bool is_submitted{false};
+    bool is_cancelled{false};
+
+    // Must be called with the lock held
+    void start(NodeId id)
+    {
+        auto& node = nodes[id];
+        node.is_started = true;
+
+        auto run_node = [state = shared_from_this(), id]() {
+            state->run(id);
+        };
+        node.handle = node.queue->push_task(std::move(run_node), priority);
+    }
+
+    void run(NodeId id)
+    {
+        auto task = Task{};
+        {
+            auto lock = std::lock_guard<std::mutex>{mutex};
+            if (is_cancelled) {
+                return;
+            }
+
+            task = std::move(nodes[id].task);
+        }
+
+        task();
+        // Tasks that add nodes capture the graph, destroy it here to break the cycle
+        task.reset();
+
+        auto lock = std::lock_guard<std::mutex>{mutex};
+        auto& node = nodes[id];
+        node.is_finished = true;
+        --unfinished_nodes;
+
+        auto successors = std::move(node.successors);
+        if (is_cancelled) {
+            return;
+        }
+
+        for (auto successor : successors) {
+            if (--nodes[successor].pending_dependencies == 0) {
+                start(successor);
+            }
+        }
+    }
+};
+
+TaskGraph::TaskGraph(AsyncTaskQueue::Priority priority)
+    : m_state{std::make_shared<State>()}
+{
+    m_state->priority = priority;
+}
+
+TaskGraph::NodeId TaskGraph::add(AsyncTaskQueue& queue, Task task, std::initializer_list<NodeId> dependencies)
+{
+    auto lock = std::lock_guard<std::mutex>{m_state->mutex};
+
+    auto const id = m_state->nodes.size();
+    auto& node = m_state->nodes.emplace_back(State::Node{
+        .task = std::move(task),
+        .queue = &queue,
+        .pending_dependencies = 0,
+        .successors = {},
+        .handle = {},
+        .is_started = false,
+        .is_finished = false,
+    });
+    ++m_state->unfinished_nodes;
+
+    for (auto dependency : dependencies) {
+        auto& dependency_node = m_state->nodes.at(dependency);
+        if (!dependency_node.is_finished) {
+            dependency_node.successors.push_back(id);
+            ++node.pending_dependencies;
+        }
+    }
+
+    if (m_state->is_submitted && !m_state->is_cancelled && node.pending_dependencies == 0) {
+        m_state->start(id);
+    }
+
+    return id;
+}
+
+void TaskGraph::add_dependency(NodeId node, NodeId dependency)
+{
+    auto lock = std::lock_guard<std::mutex>{m_state->mutex};
+
+    auto& target = m_state->nodes.at(node);
+    if (target.is_started) {
+        std::cerr << "Task graph node " << node << " already started, can't add a dependency\n";
+        return;
+    }
+
+    auto& dependency_node = m_state->nodes.at(dependency);
+    if (!dependency_node.is_finished) {
+        dependency_node.successors.push_back(node);
+        ++target.pending_dependencies;
+    }
+}
+
+void TaskGraph::submit()
+{
+    auto lock = std::lock_guard<std::mutex>{m_state->mutex};
+
+    if (m_state->is_submitted || m_state->is_cancelled) {
+        return;
+    }
+
+    m_state->is_submitted = true;
+    for (NodeId id = 0; id < m_state->nodes.size(); ++id) {
+        if (m_state->nodes[id].pending_dependencies == 0) {
+            m_state->start(id);
+        }
+    }
+}
+
+void TaskGraph::cancel()
+{
+    auto lock = std::lock_guard<std::mutex>{m_state->mutex};
+
+    m_state->is_cancelled = true;
+    for (auto& node : m_state->nodes) {
+        node.handle.cancel();
+        // Frees the captures early and breaks cycles of tasks that capture the graph
+        node.task.reset();
+    }
+}
+
+void TaskGraph::set_priority(AsyncTaskQueue::Priority priority)
+{
+    auto lock = std::lock_guard<std::mutex>{m_state->mutex};
+
+    if (priority >= m_state->priority) {
+        return;
+    }
+
+    m_state->priority = priority;
+    for (auto& node : m_state->nodes) {
+        if (node.is_started && !node.is_finished) {
+            node.handle.set_priority(priority);
+        }
+    }
+}
+
+AsyncTaskQueue::Priority TaskGraph::priority() const
+{
+    auto lock = std::lock_guard<std::mutex>{m_state->mutex};
+    return m_state->priority;
+}
+
+bool TaskGraph::is_cancelled() const
+{
+    auto lock = std::lock_guard<std::mutex>{m_state->mutex};
+    return m_state->is_cancelled;
+}
+
+bool TaskGraph::is_finished() const
+{
+    auto lock = std::lock_guard<std::mutex>{m_state->mutex};
+    return m_state->is_submitted && m_state->unfinished_nodes == 0;
+}
@@ -0,0 +1,127 @@
+#include "core/TextureCache.hpp"
+
+#include "core/CacheFile.hpp"
+#include "core/MappedFile.hpp"
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+/*
+ * File layout, all values in native byte order:
+ *
+ *   header: magic, version, source mtime, source path
+ *   image:  width, height, channels, format, mip count, mips, data
+ *   mip:    width, height, offset, size (offset into data)
+ *
+ * The data starts at an offset that is a multiple of `ARRAY_ALIGNMENT`.
+ */
+
+constexpr char MAGIC[4] = {'3', 'D', 'T', 'C'};
+
+std::filesystem::path TextureCache::cache_file(std::filesystem::path cache_directory, std::filesystem::path source)
+{
+    auto const hash = std::hash<std::string>{}(source.generic_string());
+    return cache_directory / "textures" / (std::to_string(hash) + ".tex");
+}
+
+std::optional<CompressedImage> TextureCache::load(std::filesystem::path cache_file, std::filesystem::path source)
+{
+    try {
+        if (!std::filesystem::is_regular_file(cache_file)) {
+            return {};
+        }
+
+        // The image keeps the mapping alive until it is uploaded
+        auto mapped_file = MappedFile::open(cache_file);
+        if (!mapped_file.has_value()) {
+            return {};
+        }
+        auto file = std::make_shared<MappedFile const>(std::move(mapped_file.value()));
+
+        auto reader = CacheReader{file->data()};
+
+        char magic[4];
+        std::uint32_t version;
+        std::int64_t mtime;
+        std::string source_path;
+        auto const header_valid = reader.read(magic)
+            && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+            && reader.read(version) && version == VERSION
+            && reader.read(mtime) && mtime == CacheFile::source_mtime(source)
+            && reader.read_string(source_path) && source_path == source.generic_string();
+        if (!header_valid) {
+            return {};
+        }
+
+        auto image = CompressedImage{};
+        std::uint32_t mip_count;
+        std::uint64_t data_size;
+        auto success = reader.read(image.width)
+            && reader.read(image.height)
+            && reader.read(image.channels)
+            && reader.read(image.format)
+            && (image.format == CompressedFormat::BC1_SRGB || image.format == CompressedFormat::BC3_SRGB || image.format == CompressedFormat::BC4)
+            && reader.read(mip_count)
+            && mip_count > 0 && mip_count <= 32;
+        for (std::uint32_t i = 0; success && i < mip_count; ++i) {
+            auto& mip = image.mips.emplace_back();
+            std::uint64_t offset;
+            std::uint64_t size;
+            success = reader.read(mip.width) && reader.read(mip.height) && reader.read(offset) && reader.read(size);
+            mip.offset = static_cast<std::size_t>(offset);
+            mip.size = static_cast<std::size_t>(size);
+        }
+        success = success
+            && reader.read(data_size)
+            && reader.read_span(image.data, static_cast<std::size_t>(data_size));
+        for (auto const& mip : image.mips) {
+            auto const expected_size = static_cast<std::size_t>((mip.width + 3) / 4) * ((mip.height + 3) / 4) * CompressedImage::block_size(image.format);
+            success = success && mip.width > 0 && mip.height > 0 && mip.size == expected_size && mip.offset <= data_size && mip.size <= data_size - mip.offset;
+        }
+        if (!success) {
+            std::cerr << "Texture cache " << cache_file << " is corrupted\n";
+            return {};
+        }
+
+        image.storage = file;
+        return image;
+    } catch (std::exception const& e) {
+        std::cerr << "Failed to read texture cache " << cache_file << ": " << e.what() << "\n";
+        return {};
+    }
+}
+
+bool TextureCache::store(std::filesystem::path cache_file, std::filesystem::path source, CompressedImage const& image)
+{
+    auto writer = CacheWriter{};
+    writer.write(MAGIC);
+    writer.write(VERSION);
+
+    try {
+        writer.write(CacheFile::source_mtime(source));
+        writer.write_string(source.generic_string());
+
+        writer.write(image.width);
+        writer.write(image.height);
+        writer.write(image.channels);
+        writer.write(image.format);
+        writer.write(static_cast<std::uint32_t>(image.mips.size()));
+        for (auto const& mip : image.mips) {
+            writer.write(mip.width);
+            writer.write(mip.height);
+            writer.write(static_cast<std::uint64_t>(mip.offset));
+            writer.write(static_cast<std::uint64_t>(mip.size));
+        }
+        writer.write(static_cast<std::uint64_t>(image.data.size()));
+        writer.write_bytes(image.data);
+
+        if (!CacheFile::write(cache_file, writer.buffer())) {
+            return false;
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "Failed to write texture cache " << cache_file << ": " << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
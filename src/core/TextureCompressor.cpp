@@ -0,0 +1,335 @@
+#include "core/TextureCompressor.hpp"
+
+#include "core/AsyncTaskQueue.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+
+using Pixel = std::array<std::uint8_t, 4>;
+
+// Always RGBA, single channel images only use the first channel
+struct Level {
+    int width;
+    int height;
+    std::vector<Pixel> pixels;
+};
+
+// Levels with fewer blocks are encoded on the calling thread
+constexpr std::size_t PARALLEL_BLOCK_COUNT = 1024;
+
+Level expand(Image const& image)
+{
+    auto level = Level{
+        .width = image.width,
+        .height = image.height,
+        .pixels = std::vector<Pixel>(static_cast<std::size_t>(image.width) * image.height),
+    };
+
+    auto const channels = static_cast<std::size_t>(image.channels);
+    for (std::size_t i = 0; i < level.pixels.size(); ++i) {
+        auto const* source = &image.data[i * channels];
+        switch (channels) {
+        case 1:
+            level.pixels[i] = {source[0], source[0], source[0], 255};
+            break;
+        case 3:
+            level.pixels[i] = {source[0], source[1], source[2], 255};
+            break;
+        default:
+            level.pixels[i] = {source[0], source[1], source[2], source[3]};
+            break;
+        }
+    }
+
+    return level;
+}
+
+std::uint16_t to_565(glm::vec3 color)
+{
+    auto const r = static_cast<std::uint16_t>(std::clamp(std::round(color.r * 31.0f / 255.0f), 0.0f, 31.0f));
+    auto const g = static_cast<std::uint16_t>(std::clamp(std::round(color.g * 63.0f / 255.0f), 0.0f, 63.0f));
+    auto const b = static_cast<std::uint16_t>(std::clamp(std::round(color.b * 31.0f / 255.0f), 0.0f, 31.0f));
+    return static_cast<std::uint16_t>(r << 11 | g << 5 | b);
+}
+
+glm::vec3 from_565(std::uint16_t color)
+{
+    auto const r = (color >> 11) & 31;
+    auto const g = (color >> 5) & 63;
+    auto const b = color & 31;
+    return glm::vec3{(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+// Picks the nearest of the 4 palette colors for every pixel, returns the packed indices and the squared error
+std::pair<std::uint32_t, float> bc1_indices(std::array<glm::vec3, 16> const& colors, std::uint16_t c0, std::uint16_t c1)
+{
+    auto const p0 = from_565(c0);
+    auto const p1 = from_565(c1);
+    glm::vec3 const palette[4] = {p0, p1, (2.0f * p0 + p1) / 3.0f, (p0 + 2.0f * p1) / 3.0f};
+
+    std::uint32_t indices = 0;
+    auto error = 0.0f;
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+        auto best_index = 0u;
+        auto best_distance = std::numeric_limits<float>::infinity();
+        for (auto index = 0u; index < 4; ++index) {
+            auto const difference = colors[i] - palette[index];
+            auto const distance = glm::dot(difference, difference);
+            if (distance < best_distance) {
+                best_distance = distance;
+                best_index = index;
+            }
+        }
+        indices |= best_index << (2 * i);
+        error += best_distance;
+    }
+
+    return {indices, error};
+}
+
+// Solves for the endpoints that best fit the colors with the given indices
+std::pair<glm::vec3, glm::vec3> bc1_least_squares(std::array<glm::vec3, 16> const& colors, std::uint32_t indices)
+{
+    constexpr float WEIGHTS[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+    auto aa = 0.0f;
+    auto bb = 0.0f;
+    auto ab = 0.0f;
+    auto ax = glm::vec3{0.0f};
+    auto bx = glm::vec3{0.0f};
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+        auto const a = WEIGHTS[(indices >> (2 * i)) & 3];
+        auto const b = 1.0f - a;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        ax += a * colors[i];
+        bx += b * colors[i];
+    }
+
+    auto const determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f) {
+        return {glm::vec3{-1.0f}, glm::vec3{-1.0f}};
+    }
+
+    return {(ax * bb - bx * ab) / determinant, (bx * aa - ax * ab) / determinant};
+}
+
+void write_u16(std::byte* out, std::uint16_t value)
+{
+    out[0] = static_cast<std::byte>(value & 0xff);
+    out[1] = static_cast<std::byte>(value >> 8);
+}
+
+// Always uses the 4 color mode (c0 > c1), which is also the only mode of the color part of BC3
+void encode_bc1(std::array<Pixel, 16> const& pixels, std::byte* out)
+{
+    std::array<glm::vec3, 16> colors;
+    auto mean = glm::vec3{0.0f};
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+        colors[i] = glm::vec3{pixels[i][0], pixels[i][1], pixels[i][2]};
+        mean += colors[i];
+    }
+    mean /= 16.0f;
+
+    // Principal axis of the colors by power iteration on the covariance matrix
+    auto covariance = glm::mat3{0.0f};
+    for (auto const& color : colors) {
+        auto const d = color - mean;
+        covariance += glm::outerProduct(d, d);
+    }
+
+    // Starts at the diagonal of the bounding box, which is close to the principal axis for most blocks
+    auto color_min = colors[0];
+    auto color_max = colors[0];
+    for (auto const& color : colors) {
+        color_min = glm::min(color_min, color);
+        color_max = glm::max(color_max, color);
+    }
+
+    auto axis = color_max - color_min;
+    if (auto const length = glm::length(axis); length > 0.0f) {
+        axis /= length;
+    }
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        auto const next = covariance * axis;
+        auto const length = glm::length(next);
+        if (length < 1e-6f) {
+            break;
+        }
+        axis = next / length;
+    }
+
+    auto t_min = 0.0f;
+    auto t_max = 0.0f;
+    for (auto const& color : colors) {
+        auto const t = glm::dot(color - mean, axis);
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+
+    // Move the endpoints slightly inwards, the extremes are rarely the best fit for the pixels in between
+    auto const inset = (t_max - t_min) / 16.0f;
+    auto c0 = to_565(mean + axis * (t_max - inset));
+    auto c1 = to_565(mean + axis * (t_min + inset));
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+
+    std::uint32_t indices = 0;
+    if (c0 != c1) {
+        auto [best_indices, best_error] = bc1_indices(colors, c0, c1);
+        indices = best_indices;
+
+        auto const [end0, end1] = bc1_least_squares(colors, indices);
+        if (end0.x >= 0.0f) {
+            auto refined_c0 = to_565(end0);
+            auto refined_c1 = to_565(end1);
+            if (refined_c0 < refined_c1) {
+                std::swap(refined_c0, refined_c1);
+            }
+            if (refined_c0 != refined_c1) {
+                auto const [refined_indices, refined_error] = bc1_indices(colors, refined_c0, refined_c1);
+                if (refined_error < best_error) {
+                    c0 = refined_c0;
+                    c1 = refined_c1;
+                    indices = refined_indices;
+                }
+            }
+        }
+    }
+
+    write_u16(out, c0);
+    write_u16(out + 2, c1);
+    write_u16(out + 4, static_cast<std::uint16_t>(indices & 0xffff));
+    write_u16(out + 6, static_cast<std::uint16_t>(indices >> 16));
+}
+
+// Always uses the 8 value mode (a0 > a1), which includes the exact minimum and maximum of the block
+void encode_bc4(std::array<std::uint8_t, 16> const& values, std::byte* out)
+{
+    auto const [min, max] = std::minmax_element(values.begin(), values.end());
+    auto const a0 = static_cast<int>(*max);
+    auto const a1 = static_cast<int>(*min);
+
+    int palette[8] = {a0, a1};
+    for (int k = 2; k < 8; ++k) {
+        palette[k] = ((8 - k) * a0 + (k - 1) * a1 + 3) / 7;
+    }
+
+    std::uint64_t indices = 0;
+    if (a0 != a1) {
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            auto best_index = 0u;
+            auto best_distance = 256;
+            for (auto index = 0u; index < 8; ++index) {
+                auto const distance = std::abs(values[i] - palette[index]);
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best_index = index;
+                }
+            }
+            indices |= static_cast<std::uint64_t>(best_index) << (3 * i);
+        }
+    }
+
+    out[0] = static_cast<std::byte>(a0);
+    out[1] = static_cast<std::byte>(a1);
+    for (std::size_t i = 0; i < 6; ++i) {
+        out[2 + i] = static_cast<std::byte>((indices >> (8 * i)) & 0xff);
+    }
+}
+
+void encode_level(Level const& level, CompressedFormat format, std::byte* out)
+{
+    auto const blocks_x = static_cast<std::size_t>((level.width + 3) / 4);
+    auto const blocks_y = static_cast<std::size_t>((level.height + 3) / 4);
+    auto const block_size = CompressedImage::block_size(format);
+
+    auto encode_row = [&](std::size_t block_y) {
+        for (std::size_t block_x = 0; block_x < blocks_x; ++block_x) {
+            // Blocks that reach over the edge repeat the last row and column
+            std::array<Pixel, 16> pixels;
+            for (std::size_t i = 0; i < pixels.size(); ++i) {
+                auto const x = std::min(static_cast<int>(block_x * 4 + i % 4), level.width - 1);
+                auto const y = std::min(static_cast<int>(block_y * 4 + i / 4), level.height - 1);
+                pixels[i] = level.pixels[static_cast<std::size_t>(y) * level.width + x];
+            }
+
+            auto* block = out + (block_y * blocks_x + block_x) * block_size;
+            std::array<std::uint8_t, 16> values;
+            switch (format) {
+            case CompressedFormat::BC1_SRGB:
+                encode_bc1(pixels, block);
+                break;
+            case CompressedFormat::BC3_SRGB:
+                std::transform(pixels.begin(), pixels.end(), values.begin(), [](auto const& pixel) { return pixel[3]; });
+                encode_bc4(values, block);
+                encode_bc1(pixels, block + 8);
+                break;
+            case CompressedFormat::BC4:
+                std::transform(pixels.begin(), pixels.end(), values.begin(), [](auto const& pixel) { return pixel[0]; });
+                encode_bc4(values, block);
+                break;
+            }
+        }
+    };
+
+    if (blocks_x * blocks_y >= PARALLEL_BLOCK_COUNT) {
+        AsyncTaskQueue::background.parallel_for(blocks_y, encode_row);
+    } else {
+        for (std::size_t block_y = 0; block_y < blocks_y; ++block_y) {
+            encode_row(block_y);
+        }
+    }
+}
+
+CompressedImage TextureCompressor::compress(Image const& image)
+{
+    auto format = CompressedFormat::BC1_SRGB;
+    if (image.channels == 1) {
+        format = CompressedFormat::BC4;
+    } else if (image.channels == 4) {
+        auto opaque = true;
+        for (std::size_t i = 3; i < image.data.size() && opaque; i += 4) {
+            opaque = image.data[i] == 255;
+        }
+        format = opaque ? CompressedFormat::BC1_SRGB : CompressedFormat::BC3_SRGB;
+    }
+
+    auto mips = std::vector<CompressedMip>{};
+    std::size_t size = 0;
+    for (auto width = image.width, height = image.height;; width = std::max(width / 2, 1), height = std::max(height / 2, 1)) {
+        auto const mip_size = static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * CompressedImage::block_size(format);
+        mips.push_back(CompressedMip{.width = width, .height = height, .offset = size, .size = mip_size});
+        size += mip_size;
+        if (width == 1 && height == 1) {
+            break;
+        }
+    }
+
+    // Only the current level is kept, each one is downsampled from the previous one
+    auto buffer = std::make_shared<std::vector<std::byte>>(size);
+    auto level = std::optional<Image>{};
+    for (std::size_t i = 0; i < mips.size(); ++i) {
+        auto const& source = level.has_value() ? level.value() : image;
+        encode_level(expand(source), format, buffer->data() + mips[i].offset);
+        if (i + 1 < mips.size()) {
+            level = source.downsample();
+        }
+    }
+
+    return CompressedImage{
+        .width = image.width,
+        .height = image.height,
+        .channels = image.channels,
+        .format = format,
+        .mips = std::move(mips),
+        .data = std::span<std::byte const>{*buffer},
+        .storage = buffer,
+    };
+}
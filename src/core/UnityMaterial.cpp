@@ -0,0 +1,168 @@
+#include "core/UnityMaterial.hpp"
+
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <string_view>
+
+// The parts of a material file that contain properties:
+//
+//   m_SavedProperties:
+//     m_TexEnvs:
+//     - _MainTex:
+//         m_Texture: {fileID: 2800000, guid: 0123456789abcdef0123456789abcdef, type: 3}
+//     m_Floats:
+//     - _Glossiness: 0.5
+//     m_Colors:
+//     - _Color: {r: 1, g: 1, b: 1, a: 1}
+enum class Section {
+    OTHER,
+    TEXTURES,
+    FLOATS,
+    COLORS,
+};
+
+std::string_view trim(std::string_view string)
+{
+    auto const start = string.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos) {
+        return {};
+    }
+
+    auto const end = string.find_last_not_of(" \t\r");
+    return string.substr(start, end - start + 1);
+}
+
+std::optional<float> parse_float(std::string_view string)
+{
+    string = trim(string);
+    auto value = 0.0f;
+    auto [end, error] = std::from_chars(string.data(), string.data() + string.size(), value);
+    if (error != std::errc{}) {
+        return {};
+    }
+
+    return value;
+}
+
+// Parses `{r: 1, g: 1, b: 1, a: 1}`
+std::optional<glm::vec4> parse_color(std::string_view string)
+{
+    auto color = glm::vec4{0.0f};
+    auto const components = std::array<std::string_view, 4>{"r: ", "g: ", "b: ", "a: "};
+    for (std::size_t i = 0; i < components.size(); ++i) {
+        auto const start = string.find(components[i]);
+        if (start == std::string_view::npos) {
+            return {};
+        }
+
+        auto value = string.substr(start + components[i].size());
+        value = value.substr(0, value.find_first_of(",}"));
+        auto const component = parse_float(value);
+        if (!component.has_value()) {
+            return {};
+        }
+        color[static_cast<glm::length_t>(i)] = component.value();
+    }
+
+    return color;
+}
+
+std::optional<UnityMaterial> UnityMaterial::parse(std::filesystem::path const& path, std::filesystem::file_time_type mtime)
+{
+    auto stream = std::ifstream{path};
+    if (!stream) {
+        return {};
+    }
+
+    auto material = UnityMaterial{
+        .mtime = mtime,
+        .textures = {},
+        .floats = {},
+        .colors = {},
+    };
+
+    auto section = Section::OTHER;
+    // Texture properties span multiple lines, the guid follows the property name
+    std::optional<std::string> texture_property;
+
+    std::string line;
+    while (std::getline(stream, line)) {
+        auto const content = trim(line);
+
+        if (content.starts_with("m_") && content.ends_with(":")) {
+            if (content == "m_TexEnvs:") {
+                section = Section::TEXTURES;
+            } else if (content == "m_Floats:") {
+                section = Section::FLOATS;
+            } else if (content == "m_Colors:") {
+                section = Section::COLORS;
+            } else {
+                section = Section::OTHER;
+            }
+            texture_property = {};
+            continue;
+        }
+
+        if (section == Section::OTHER) {
+            continue;
+        }
+
+        if (content.starts_with("- ")) {
+            auto const separator = content.find(':');
+            if (separator == std::string_view::npos) {
+                continue;
+            }
+
+            auto const name = std::string{trim(content.substr(2, separator - 2))};
+            auto const value = content.substr(separator + 1);
+            texture_property = {};
+
+            if (section == Section::TEXTURES) {
+                texture_property = name;
+            } else if (section == Section::FLOATS) {
+                if (auto number = parse_float(value); number.has_value()) {
+                    material.floats[name] = number.value();
+                }
+            } else if (auto color = parse_color(value); color.has_value()) {
+                material.colors[name] = color.value();
+            }
+            continue;
+        }
+
+        if (section == Section::TEXTURES && texture_property.has_value() && content.starts_with("m_Texture:")) {
+            auto const start = content.find("guid: ");
+            auto const guid_length = 32;
+            if (start != std::string_view::npos && content.size() >= start + 6 + guid_length) {
+                material.textures[texture_property.value()] = std::string{content.substr(start + 6, guid_length)};
+            }
+            texture_property = {};
+        }
+    }
+
+    return material;
+}
+
+std::optional<std::string> UnityMaterial::texture_guid(std::string const& property) const
+{
+    if (auto it = textures.find(property); it != textures.end()) {
+        return it->second;
+    }
+
+    return {};
+}
+
+std::optional<std::string> UnityMaterial::base_texture_guid() const
+{
+    // The built-in render pipeline uses `_MainTex`, URP and HDRP use `_BaseMap`
+    if (auto guid = texture_guid("_MainTex"); guid.has_value()) {
+        return guid;
+    }
+
+    return texture_guid("_BaseMap");
+}
+
+std::optional<std::string> UnityMaterial::mask_texture_guid() const
+{
+    return texture_guid("_Mask");
+}
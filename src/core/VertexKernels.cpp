@@ -0,0 +1,172 @@
+#include "core/VertexKernels.hpp"
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define VERTEX_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+// The SIMD kernels treat a vertex as two groups of four floats: [px py pz nx] and [ny nz u v]
+static_assert(sizeof(Vertex) == 8 * sizeof(float));
+static_assert(offsetof(Vertex, m_normal) == 3 * sizeof(float));
+static_assert(offsetof(Vertex, m_tex_coords) == 6 * sizeof(float));
+
+AABB empty_aabb()
+{
+    return AABB{
+        .min = glm::vec3{std::numeric_limits<float>::max()},
+        .max = glm::vec3{std::numeric_limits<float>::lowest()},
+    };
+}
+
+template <bool has_normals, bool has_tex_coords>
+void interleave_scalar_range(std::span<Vertex> vertices, std::size_t first, float const* positions, float const* normals, float const* tex_coords)
+{
+    for (auto i = first; i < vertices.size(); ++i) {
+        auto& vertex = vertices[i];
+        vertex.m_position = glm::vec3{positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]};
+        vertex.m_normal = has_normals ? glm::vec3{normals[3 * i], normals[3 * i + 1], normals[3 * i + 2]} : glm::vec3{0.0f};
+        vertex.m_tex_coords = has_tex_coords ? glm::vec2{tex_coords[3 * i], tex_coords[3 * i + 1]} : glm::vec2{0.0f};
+    }
+}
+
+#ifdef VERTEX_KERNELS_SSE2
+template <bool has_normals, bool has_tex_coords>
+void interleave_sse2(std::span<Vertex> vertices, float const* positions, float const* normals, float const* tex_coords)
+{
+    auto const zero = _mm_setzero_ps();
+    auto* out = reinterpret_cast<float*>(vertices.data());
+
+    // Each load reads one float of the next vertex, so the last vertex is done by the scalar loop
+    std::size_t i = 0;
+    for (; i + 1 < vertices.size(); ++i) {
+        auto const position = _mm_loadu_ps(positions + 3 * i);
+        auto const normal = has_normals ? _mm_loadu_ps(normals + 3 * i) : zero;
+        auto const tex_coord = has_tex_coords ? _mm_loadu_ps(tex_coords + 3 * i) : zero;
+
+        auto const pz_nx = _mm_shuffle_ps(position, normal, _MM_SHUFFLE(0, 0, 2, 2)); // [pz pz nx nx]
+        auto const low = _mm_shuffle_ps(position, pz_nx, _MM_SHUFFLE(2, 0, 1, 0)); // [px py pz nx]
+        auto const high = _mm_shuffle_ps(normal, tex_coord, _MM_SHUFFLE(1, 0, 2, 1)); // [ny nz u v]
+
+        _mm_storeu_ps(out + 8 * i, low);
+        _mm_storeu_ps(out + 8 * i + 4, high);
+    }
+
+    interleave_scalar_range<has_normals, has_tex_coords>(vertices, i, positions, normals, tex_coords);
+}
+#endif
+
+// Picks the instantiation once, instead of checking for the attributes for every vertex.
+// `kernel` is called with two `std::bool_constant`s.
+template <typename Kernel>
+void dispatch_interleave(bool has_normals, bool has_tex_coords, Kernel kernel)
+{
+    if (has_normals && has_tex_coords) {
+        kernel(std::true_type{}, std::true_type{});
+    } else if (has_normals) {
+        kernel(std::true_type{}, std::false_type{});
+    } else if (has_tex_coords) {
+        kernel(std::false_type{}, std::true_type{});
+    } else {
+        kernel(std::false_type{}, std::false_type{});
+    }
+}
+
+void VertexKernels::interleave(std::span<Vertex> vertices, float const* positions, float const* normals, float const* tex_coords)
+{
+#ifdef VERTEX_KERNELS_SSE2
+    dispatch_interleave(normals != nullptr, tex_coords != nullptr, [&](auto has_normals, auto has_tex_coords) {
+        interleave_sse2<has_normals, has_tex_coords>(vertices, positions, normals, tex_coords);
+    });
+#else
+    interleave_scalar(vertices, positions, normals, tex_coords);
+#endif
+}
+
+void VertexKernels::interleave_scalar(std::span<Vertex> vertices, float const* positions, float const* normals, float const* tex_coords)
+{
+    dispatch_interleave(normals != nullptr, tex_coords != nullptr, [&](auto has_normals, auto has_tex_coords) {
+        interleave_scalar_range<has_normals, has_tex_coords>(vertices, 0, positions, normals, tex_coords);
+    });
+}
+
+void VertexKernels::translate(std::span<Vertex> vertices, glm::vec3 offset)
+{
+#ifdef VERTEX_KERNELS_SSE2
+    // The fourth lane is the x component of the normal, which must stay unchanged
+    auto const offset_low = _mm_set_ps(0.0f, offset.z, offset.y, offset.x);
+    auto* data = reinterpret_cast<float*>(vertices.data());
+
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        auto* low = data + 8 * i;
+        _mm_storeu_ps(low, _mm_add_ps(_mm_loadu_ps(low), offset_low));
+    }
+#else
+    translate_scalar(vertices, offset);
+#endif
+}
+
+void VertexKernels::translate_scalar(std::span<Vertex> vertices, glm::vec3 offset)
+{
+    for (auto& vertex : vertices) {
+        vertex.m_position += offset;
+    }
+}
+
+AABB VertexKernels::compute_aabb(std::span<Vertex const> vertices)
+{
+#ifdef VERTEX_KERNELS_SSE2
+    if (vertices.empty()) {
+        return empty_aabb();
+    }
+
+    // The fourth lane is the x component of the normal and is ignored.
+    // Two pairs of accumulators, so consecutive vertices don't wait for each other.
+    auto const* data = reinterpret_cast<float const*>(vertices.data());
+    auto min_a = _mm_loadu_ps(data);
+    auto max_a = min_a;
+    auto min_b = min_a;
+    auto max_b = min_a;
+
+    std::size_t i = 1;
+    for (; i + 1 < vertices.size(); i += 2) {
+        auto const a = _mm_loadu_ps(data + 8 * i);
+        auto const b = _mm_loadu_ps(data + 8 * i + 8);
+        min_a = _mm_min_ps(min_a, a);
+        max_a = _mm_max_ps(max_a, a);
+        min_b = _mm_min_ps(min_b, b);
+        max_b = _mm_max_ps(max_b, b);
+    }
+    if (i < vertices.size()) {
+        auto const a = _mm_loadu_ps(data + 8 * i);
+        min_a = _mm_min_ps(min_a, a);
+        max_a = _mm_max_ps(max_a, a);
+    }
+
+    alignas(16) float min[4];
+    alignas(16) float max[4];
+    _mm_store_ps(min, _mm_min_ps(min_a, min_b));
+    _mm_store_ps(max, _mm_max_ps(max_a, max_b));
+
+    return AABB{
+        .min = glm::vec3{min[0], min[1], min[2]},
+        .max = glm::vec3{max[0], max[1], max[2]},
+    };
+#else
+    return compute_aabb_scalar(vertices);
+#endif
+}
+
+AABB VertexKernels::compute_aabb_scalar(std::span<Vertex const> vertices)
+{
+    auto aabb = empty_aabb();
+    for (auto const& vertex : vertices) {
+        aabb.min = glm::min(aabb.min, vertex.m_position);
+        aabb.max = glm::max(aabb.max, vertex.m_position);
+    }
+
+    return aabb;
+}
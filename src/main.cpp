@@ -12,6 +12,7 @@
 #include "ui/Viewport.hpp"
 
 #include <ImGuizmo.h>
+#include <chrono>
 #include <filesystem>
 #include <glfw.h>
 #include <imgui.h>
@@ -122,6 +123,7 @@ int main(int argc, char** argv)
         if (!project->scene) {
             project->scene = std::make_unique<InstancedNode>();
             auto obj = project->get_model(input_path);
+            project->wait_for_models();
             if (obj) {
                 project->scene->children.push_back(obj->instantiate());
                 focus_on_scene = true;
@@ -190,7 +192,10 @@ int main(int argc, char** argv)
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
         Input::late_update();
-        AsyncTaskQueue::main.run();
+
+        // Spreading uploads over multiple frames keeps the editor responsive while a scene streams in
+        auto const main_thread_budget = std::chrono::duration<float, std::milli>{project->config.main_thread_budget};
+        AsyncTaskQueue::main.run_for(std::chrono::duration_cast<std::chrono::microseconds>(main_thread_budget));
 
         /* Swap front and back buffers */
         glfwSwapBuffers(window);
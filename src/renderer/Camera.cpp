@@ -1,7 +1,10 @@
 #include "renderer/Camera.hpp"
 
 #include "core/Project.hpp"
+#include <array>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
 Framebuffer Framebuffer::get_default(int width, int height)
 {
@@ -145,6 +148,51 @@ glm::mat4 Camera::projection(float aspect) const
     return glm::perspective(fov, aspect, near, far);
 }
 
+// Conservative test, returns true if any part of the AABB might be inside the view frustum
+bool is_in_view(glm::mat4 const& model_view_projection, AABB const& aabb)
+{
+    std::array<glm::vec4, 8> corners;
+    for (std::size_t i = 0; i < corners.size(); ++i) {
+        auto const corner = glm::vec3{
+            i & 1 ? aabb.max.x : aabb.min.x,
+            i & 2 ? aabb.max.y : aabb.min.y,
+            i & 4 ? aabb.max.z : aabb.min.z,
+        };
+        corners[i] = model_view_projection * glm::vec4{corner, 1.0f};
+    }
+
+    // The box is outside if all corners are on the outer side of the same clipping plane
+    for (int axis = 0; axis < 3; ++axis) {
+        auto all_below = true;
+        auto all_above = true;
+        for (auto const& corner : corners) {
+            all_below = all_below && corner[axis] < -corner.w;
+            all_above = all_above && corner[axis] > corner.w;
+        }
+
+        if (all_below || all_above) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Length of the AABB diagonal on screen in pixels
+float projected_size(glm::mat4 const& model, AABB const& aabb, glm::vec3 const& camera_position, float fov, int viewport_height)
+{
+    auto const center = glm::vec3{model * glm::vec4{(aabb.min + aabb.max) * 0.5f, 1.0f}};
+    auto const diagonal = glm::length(glm::vec3{model * glm::vec4{aabb.max - aabb.min, 0.0f}});
+    auto const distance = glm::length(center - camera_position);
+
+    // The camera is inside of the box
+    if (distance <= diagonal * 0.5f) {
+        return std::numeric_limits<float>::infinity();
+    }
+
+    return diagonal / distance / std::tan(fov * 0.5f) * static_cast<float>(viewport_height) * 0.5f;
+}
+
 void Camera::draw(ViewingMode mode,
     Uniforms const& uniforms,
     Framebuffer const& framebuffer,
@@ -170,16 +218,60 @@ void Camera::draw(ViewingMode mode,
     shader.set_uniform(shader.uniform_locations.light_color, uniforms.light.color);
     shader.set_uniform(shader.uniform_locations.light_power, uniforms.light.power);
 
-    node.traverse([&](auto transform_matrix, auto const& node_data) {
-        shader.set_uniform(shader.uniform_locations.model, transform_matrix);
-        for (auto const& mesh : node_data.meshes) {
-            mesh.draw(mode);
-        }
-    });
+    auto const view_projection = projection(framebuffer.aspect) * view();
+    draw_subtree(mode, shader, view_projection, framebuffer.height, node, true);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void Camera::draw_subtree(ViewingMode mode,
+    Shader const& shader,
+    glm::mat4 const& view_projection,
+    int viewport_height,
+    InstancedNode const& node,
+    bool may_use_proxy)
+{
+    auto project = Project::get_current();
+    auto const& config = project->config;
+
+    // Subtrees with many meshes that are small on screen are drawn as a single merged mesh
+    if (may_use_proxy && node.bounds && node.mesh_count >= HlodBuilder::MIN_MESHES
+        && projected_size(glm::mat4{1.0f}, *node.bounds, position, fov, viewport_height) < config.hlod_pixel_size) {
+        if (auto proxy = project->get_hlod_proxy(node)) {
+            shader.set_uniform(shader.uniform_locations.model, node.model_matrix);
+            proxy->mesh.draw(mode);
+            return;
+        }
+
+        // Only the largest small subtree gets a proxy, the nodes below are drawn as is until it's ready
+        may_use_proxy = false;
+    }
+
+    if (node.node) {
+        shader.set_uniform(shader.uniform_locations.model, node.model_matrix);
+        for (auto const& mesh : node.node->meshes) {
+            mesh.m_texture_diffuse->last_used_frame = project->frame();
+            mesh.m_texture_opacity->last_used_frame = project->frame();
+
+            // Textures of meshes in view are loaded before everything else
+            if (!mesh.m_texture_diffuse->is_loaded || !mesh.m_texture_opacity->is_loaded) {
+                auto const priority = is_in_view(view_projection * node.model_matrix, mesh.aabb)
+                    ? AsyncTaskQueue::Priority::VISIBLE_NOW
+                    : AsyncTaskQueue::Priority::VISIBLE_SOON;
+                project->request_texture(mesh.m_texture_diffuse, priority);
+                project->request_texture(mesh.m_texture_opacity, priority);
+            }
+
+            auto const size = projected_size(node.model_matrix, mesh.aabb, position, fov, viewport_height);
+            mesh.draw(mode, mesh.select_lod(size, config.lod_pixel_error));
+        }
+    }
+
+    for (auto const& child : node.children) {
+        draw_subtree(mode, shader, view_projection, viewport_height, *child, may_use_proxy);
+    }
+}
+
 void Camera::draw_outline(Framebuffer const& framebuffer, InstancedNode const& node)
 {
     auto project = Project::get_current();
@@ -203,7 +295,7 @@ void Camera::draw_outline(Framebuffer const& framebuffer, InstancedNode const& n
     node.traverse([&](auto transform_matrix, auto const& node_data) {
         Shader::albedo.set_uniform(Shader::albedo.uniform_locations.model, transform_matrix);
         for (auto const& mesh : node_data.meshes) {
-            mesh.draw();
+            mesh.draw(Shader::albedo);
         }
     });
 
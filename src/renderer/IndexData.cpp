@@ -0,0 +1,78 @@
+#include "renderer/IndexData.hpp"
+
+#include <cstring>
+#include <limits>
+
+std::size_t index_size(IndexType type)
+{
+    return type == IndexType::UINT16 ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+}
+
+GLenum gl_index_type(IndexType type)
+{
+    return type == IndexType::UINT16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+IndexData::IndexData(std::span<unsigned int const> indices, std::size_t vertex_count)
+    : m_type{vertex_count <= std::numeric_limits<std::uint16_t>::max() + std::size_t{1} ? IndexType::UINT16 : IndexType::UINT32}
+    , m_data(indices.size() * index_size(m_type))
+{
+    if (m_type == IndexType::UINT32) {
+        std::memcpy(m_data.data(), indices.data(), m_data.size());
+        return;
+    }
+
+    auto* data = m_data.data();
+    for (auto index : indices) {
+        auto const narrowed = static_cast<std::uint16_t>(index);
+        std::memcpy(data, &narrowed, sizeof(narrowed));
+        data += sizeof(narrowed);
+    }
+}
+
+IndexData::IndexData(std::span<std::byte const> bytes, IndexType type)
+    : m_type{type}
+    , m_data(bytes.begin(), bytes.end())
+{ }
+
+IndexType IndexData::type() const
+{
+    return m_type;
+}
+
+std::size_t IndexData::size() const
+{
+    return m_data.size() / index_size(m_type);
+}
+
+bool IndexData::empty() const
+{
+    return m_data.empty();
+}
+
+unsigned int IndexData::operator[](std::size_t i) const
+{
+    if (m_type == IndexType::UINT16) {
+        std::uint16_t index;
+        std::memcpy(&index, m_data.data() + i * sizeof(index), sizeof(index));
+        return index;
+    }
+
+    std::uint32_t index;
+    std::memcpy(&index, m_data.data() + i * sizeof(index), sizeof(index));
+    return index;
+}
+
+std::span<std::byte const> IndexData::bytes() const
+{
+    return m_data;
+}
+
+std::vector<unsigned int> IndexData::to_vector() const
+{
+    auto indices = std::vector<unsigned int>(size());
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = (*this)[i];
+    }
+    return indices;
+}
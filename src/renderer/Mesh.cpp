@@ -1,23 +1,86 @@
 #include "renderer/Mesh.hpp"
 
 #include "core/Project.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+#include <limits>
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, Texture const* texture_diffuse, Texture const* texture_opacity, AABB aabb)
-    : m_vertices(vertices)
-    , m_indices(indices)
+std::atomic<std::size_t> Mesh::total_released_bytes{0};
+
+// Meshes without simplified LODs draw all of their indices
+std::vector<MeshLod> lods_or_whole_mesh(std::vector<MeshLod> lods, std::size_t index_count)
+{
+    if (lods.empty()) {
+        lods.push_back(MeshLod{0, static_cast<std::uint32_t>(index_count), 0.0f});
+    }
+
+    return lods;
+}
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, Texture const* texture_diffuse, Texture const* texture_opacity, AABB aabb, std::vector<MeshLod> lods)
+    : m_vertices(std::move(vertices))
+    , m_indices(indices, m_vertices.size())
     , m_texture_diffuse(texture_diffuse)
     , m_texture_opacity(texture_opacity)
     , aabb(aabb)
+    , m_index_type(m_indices.type())
+    , m_vertex_count(m_vertices.size())
+    , m_index_count(m_indices.size())
+    , m_lods(lods_or_whole_mesh(std::move(lods), m_index_count))
+{ }
+
+Mesh::Mesh(std::vector<QuantizedVertex> vertices, std::vector<unsigned int> indices, Texture const* texture_diffuse, Texture const* texture_opacity, AABB aabb, std::vector<MeshLod> lods)
+    : m_quantized_vertices(std::move(vertices))
+    , m_indices(indices, m_quantized_vertices.size())
+    , m_texture_diffuse(texture_diffuse)
+    , m_texture_opacity(texture_opacity)
+    , aabb(aabb)
+    , m_vertex_format(VertexFormat::QUANTIZED)
+    , m_index_type(m_indices.type())
+    , m_vertex_count(m_quantized_vertices.size())
+    , m_index_count(m_indices.size())
+    , m_lods(lods_or_whole_mesh(std::move(lods), m_index_count))
+{ }
+
+Mesh::Mesh(MappedGeometry geometry, Texture const* texture_diffuse, Texture const* texture_opacity, AABB aabb, std::vector<MeshLod> lods)
+    : m_texture_diffuse(texture_diffuse)
+    , m_texture_opacity(texture_opacity)
+    , aabb(aabb)
+    , m_vertex_format(geometry.quantized_vertices.empty() ? VertexFormat::FLOAT : VertexFormat::QUANTIZED)
+    , m_index_type(geometry.index_type)
+    , m_vertex_count(geometry.vertices.size() + geometry.quantized_vertices.size())
+    , m_index_count(geometry.indices.size() / index_size(geometry.index_type))
+    , m_lods(lods_or_whole_mesh(std::move(lods), m_index_count))
+    , m_mapped_geometry(std::move(geometry))
 { }
 
-void Mesh::draw() const
+void Mesh::draw(Shader const& shader, std::size_t lod) const
 {
+    // The buffers of meshes that were just imported are set up over the next frames
+    if (m_vao == 0) {
+        return;
+    }
+
+    // Float vertices pass through the dequantization unchanged
+    auto const is_quantized = m_vertex_format == VertexFormat::QUANTIZED;
+    shader.set_uniform(shader.uniform_locations.position_offset, is_quantized ? aabb.min : glm::vec3{0.0f});
+    shader.set_uniform(shader.uniform_locations.position_scale, is_quantized ? aabb.max - aabb.min : glm::vec3{1.0f});
+    shader.set_uniform(shader.uniform_locations.octahedral_normals, is_quantized);
+
+    auto const& range = m_lods[std::min(lod, m_lods.size() - 1)];
+    auto const offset = range.index_offset * index_size(m_index_type);
+
     glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(range.index_count), gl_index_type(m_index_type), reinterpret_cast<void const*>(offset));
 }
 
-void Mesh::draw(ViewingMode mode) const
+void Mesh::draw(ViewingMode mode, std::size_t lod) const
 {
+    if (m_vao == 0) {
+        return;
+    }
+
     auto const& shader = Shader::get_shader_for_mode(mode);
     auto diffuse_texture_id = mode == ViewingMode::SOLID ? Project::get_current()->fallback_texture()->id : m_texture_diffuse->id;
 
@@ -31,41 +94,149 @@ void Mesh::draw(ViewingMode mode) const
     shader.set_uniform(shader.uniform_locations.texture_opacity, 1);
     glBindTexture(GL_TEXTURE_2D, m_texture_opacity->id);
 
-    // set active
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(m_indices.size()), GL_UNSIGNED_INT, nullptr);
+    draw(shader, lod);
 }
 
-void Mesh::setup_mesh()
+std::size_t Mesh::select_lod(float projected_size, float pixel_error) const
+{
+    // The errors grow with each LOD
+    std::size_t lod = 0;
+    while (lod + 1 < m_lods.size() && m_lods[lod + 1].error * projected_size <= pixel_error) {
+        ++lod;
+    }
+
+    return lod;
+}
+
+std::size_t Mesh::lod_count() const
+{
+    return m_lods.size();
+}
+
+void Mesh::setup_mesh(bool keep_cpu_data)
 {
     if (m_vao != 0) {
         return;
     }
 
+    // Mapped geometry is handed to the driver directly, the OS pages it in from the cache file
+    auto const is_mapped = static_cast<bool>(m_mapped_geometry.file);
+    auto vertices = m_vertex_format == VertexFormat::QUANTIZED
+        ? std::as_bytes(is_mapped ? m_mapped_geometry.quantized_vertices : std::span<QuantizedVertex const>{m_quantized_vertices})
+        : std::as_bytes(is_mapped ? m_mapped_geometry.vertices : std::span<Vertex const>{m_vertices});
+    auto indices = is_mapped ? m_mapped_geometry.indices : m_indices.bytes();
+
     glGenVertexArrays(1, &m_vao);
     glGenBuffers(1, &m_vbo);
     glGenBuffers(1, &m_ebo);
 
     glBindVertexArray(m_vao);
     glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), &m_vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(), GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), &m_indices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(), GL_STATIC_DRAW);
+
+    if (m_vertex_format == VertexFormat::QUANTIZED) {
+        // Positions and normals are normalized to [0, 1], the shaders map them back using the AABB
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, m_position));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, m_normal));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, m_tex_coords));
+        glEnableVertexAttribArray(2);
+    } else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(0);
+        // vertex normals
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_normal));
+        glEnableVertexAttribArray(1);
+        // vertex texture coords
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_tex_coords));
+        glEnableVertexAttribArray(2);
+    }
+
+    if (!keep_cpu_data) {
+        total_released_bytes += vertices.size_bytes() + indices.size_bytes();
+        m_vertices = {};
+        m_quantized_vertices = {};
+        m_indices = {};
+        m_mapped_geometry = {};
+    }
+}
+
+void Mesh::release_buffers()
+{
+    glDeleteVertexArrays(1, &m_vao);
+    glDeleteBuffers(1, &m_vbo);
+    glDeleteBuffers(1, &m_ebo);
+    m_vao = m_vbo = m_ebo = 0;
+}
+
+bool Mesh::has_cpu_data() const
+{
+    auto const vertex_count = m_vertex_format == VertexFormat::QUANTIZED ? m_quantized_vertices.size() : m_vertices.size();
+    return m_mapped_geometry.file || vertex_count == m_vertex_count;
+}
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    // vertex normals
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_normal));
-    glEnableVertexAttribArray(1);
-    // vertex texture coords
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_tex_coords));
-    glEnableVertexAttribArray(2);
+VertexFormat Mesh::vertex_format() const
+{
+    return m_vertex_format;
+}
+
+MeshGeometry Mesh::read_geometry() const
+{
+    auto geometry = MeshGeometry{};
+    std::vector<QuantizedVertex> quantized_vertices;
+
+    if (m_mapped_geometry.file) {
+        geometry.vertices.assign(m_mapped_geometry.vertices.begin(), m_mapped_geometry.vertices.end());
+        quantized_vertices.assign(m_mapped_geometry.quantized_vertices.begin(), m_mapped_geometry.quantized_vertices.end());
+        geometry.indices = IndexData{m_mapped_geometry.indices, m_index_type}.to_vector();
+    } else if (has_cpu_data() || m_vao == 0) {
+        geometry.vertices = m_vertices;
+        quantized_vertices = m_quantized_vertices;
+        geometry.indices = m_indices.to_vector();
+    } else {
+        // GL_COPY_READ_BUFFER doesn't disturb the vertex array state
+        glBindBuffer(GL_COPY_READ_BUFFER, m_vbo);
+        if (m_vertex_format == VertexFormat::QUANTIZED) {
+            quantized_vertices.resize(m_vertex_count);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, quantized_vertices.size() * sizeof(QuantizedVertex), quantized_vertices.data());
+        } else {
+            geometry.vertices.resize(m_vertex_count);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, 0, geometry.vertices.size() * sizeof(Vertex), geometry.vertices.data());
+        }
+        auto index_bytes = std::vector<std::byte>(m_lods.front().index_count * index_size(m_index_type));
+        glBindBuffer(GL_COPY_READ_BUFFER, m_ebo);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, index_bytes.size(), index_bytes.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        geometry.indices = IndexData{index_bytes, m_index_type}.to_vector();
+    }
+
+    for (auto const& vertex : quantized_vertices) {
+        geometry.vertices.push_back(dequantize_vertex(vertex, aabb));
+    }
+
+    // LOD 0 comes first, the simplified LODs only reuse its vertices
+    geometry.indices.resize(m_lods.front().index_count);
+
+    return geometry;
+}
+
+bool Mesh::needs_readback() const
+{
+    return !has_cpu_data() && m_vao != 0;
+}
+
+std::size_t Mesh::released_bytes()
+{
+    return total_released_bytes;
 }
 
 bool Mesh::is_fully_loaded() const
 {
-    return m_texture_diffuse->is_loaded;
+    return m_vao != 0 && m_texture_diffuse->is_loaded;
 }
 
 AABB AABB::merge(AABB const& other)
@@ -75,3 +246,97 @@ AABB AABB::merge(AABB const& other)
         .max = glm::vec3{std::max(max.x, other.max.x), std::max(max.y, other.max.y), std::max(max.z, other.max.z)},
     };
 }
+
+AABB AABB::transformed(glm::mat4 const& matrix) const
+{
+    auto result = AABB{
+        .min = glm::vec3{std::numeric_limits<float>::max()},
+        .max = glm::vec3{std::numeric_limits<float>::lowest()},
+    };
+
+    for (int i = 0; i < 8; ++i) {
+        auto const corner = glm::vec3{
+            i & 1 ? max.x : min.x,
+            i & 2 ? max.y : min.y,
+            i & 4 ? max.z : min.z,
+        };
+        auto const transformed_corner = glm::vec3{matrix * glm::vec4{corner, 1.0f}};
+        result.min = glm::min(result.min, transformed_corner);
+        result.max = glm::max(result.max, transformed_corner);
+    }
+
+    return result;
+}
+
+std::uint16_t to_unorm16(float value)
+{
+    return static_cast<std::uint16_t>(std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+float from_unorm16(std::uint16_t value)
+{
+    return static_cast<float>(value) / 65535.0f;
+}
+
+float sign_not_zero(float value)
+{
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+QuantizedVertex quantize_vertex(Vertex const& vertex, AABB const& aabb)
+{
+    auto quantized = QuantizedVertex{};
+
+    auto const extent = aabb.max - aabb.min;
+    for (int i = 0; i < 3; ++i) {
+        // All vertices of a flat axis lie on the minimum
+        auto const fraction = extent[i] > 0.0f ? (vertex.m_position[i] - aabb.min[i]) / extent[i] : 0.0f;
+        quantized.m_position[i] = to_unorm16(fraction);
+    }
+
+    // Project the normal onto the octahedron |x| + |y| + |z| = 1 and fold the lower half outwards.
+    // A missing (zero) normal ends up pointing along +z.
+    auto const& normal = vertex.m_normal;
+    auto const sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    auto x = sum > 0.0f ? normal.x / sum : 0.0f;
+    auto y = sum > 0.0f ? normal.y / sum : 0.0f;
+    if (normal.z < 0.0f) {
+        auto const folded_x = (1.0f - std::abs(y)) * sign_not_zero(x);
+        y = (1.0f - std::abs(x)) * sign_not_zero(y);
+        x = folded_x;
+    }
+    quantized.m_normal[0] = to_unorm16(x * 0.5f + 0.5f);
+    quantized.m_normal[1] = to_unorm16(y * 0.5f + 0.5f);
+
+    quantized.m_tex_coords[0] = glm::packHalf1x16(vertex.m_tex_coords.x);
+    quantized.m_tex_coords[1] = glm::packHalf1x16(vertex.m_tex_coords.y);
+
+    return quantized;
+}
+
+// Must match the dequantization in the shaders
+Vertex dequantize_vertex(QuantizedVertex const& quantized, AABB const& aabb)
+{
+    auto vertex = Vertex{};
+
+    auto const extent = aabb.max - aabb.min;
+    for (int i = 0; i < 3; ++i) {
+        vertex.m_position[i] = aabb.min[i] + from_unorm16(quantized.m_position[i]) * extent[i];
+    }
+
+    auto const x = from_unorm16(quantized.m_normal[0]) * 2.0f - 1.0f;
+    auto const y = from_unorm16(quantized.m_normal[1]) * 2.0f - 1.0f;
+    auto normal = glm::vec3{x, y, 1.0f - std::abs(x) - std::abs(y)};
+    if (normal.z < 0.0f) {
+        normal.x = (1.0f - std::abs(y)) * sign_not_zero(x);
+        normal.y = (1.0f - std::abs(x)) * sign_not_zero(y);
+    }
+    vertex.m_normal = glm::normalize(normal);
+
+    vertex.m_tex_coords = glm::vec2{
+        glm::unpackHalf1x16(quantized.m_tex_coords[0]),
+        glm::unpackHalf1x16(quantized.m_tex_coords[1]),
+    };
+
+    return vertex;
+}
@@ -47,7 +47,7 @@ InstancedNode* Picking::get_selected_node(Camera const& camera, InstancedNode& s
         shader.set_uniform(shader.uniform_locations.model, transform_matrix);
 
         for (auto const& mesh : instance.node->meshes) {
-            mesh.draw();
+            mesh.draw(shader);
         }
 
         ++i;
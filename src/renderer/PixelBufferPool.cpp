@@ -0,0 +1,131 @@
+#include "renderer/PixelBufferPool.hpp"
+
+#include <algorithm>
+#include <bit>
+
+// Sizes are rounded up to a power of two, so buffers of similar textures can be reused
+constexpr std::size_t MIN_CAPACITY = 64 * 1024;
+// Free buffers beyond this are deleted
+constexpr std::size_t MAX_FREE_SIZE = 64 * 1024 * 1024;
+
+PixelBufferPool::~PixelBufferPool()
+{
+    collect();
+
+    for (auto const& buffer : m_in_flight) {
+        glDeleteSync(buffer.fence);
+        destroy(buffer);
+    }
+
+    for (auto const& buffer : m_free) {
+        destroy(buffer);
+    }
+}
+
+std::shared_ptr<PixelBuffer> PixelBufferPool::acquire(std::size_t size)
+{
+    auto const capacity = std::max(std::bit_ceil(size), MIN_CAPACITY);
+
+    auto buffer = PixelBuffer{.id = 0, .capacity = capacity, .mapping = nullptr, .fence = nullptr};
+    if (auto it = std::find_if(m_free.begin(), m_free.end(), [&](auto const& free) { return free.capacity == capacity; }); it != m_free.end()) {
+        buffer = *it;
+        m_free.erase(it);
+        m_free_size -= capacity;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+    } else {
+        glGenBuffers(1, &buffer.id);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_STREAM_DRAW);
+    }
+
+    // Unsynchronized is safe, free buffers are not read by the GPU anymore
+    auto* mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(capacity), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    // Uploads from client memory interpret their pointer as an offset while a buffer is bound
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!mapping) {
+        destroy(buffer);
+        return nullptr;
+    }
+    buffer.mapping = static_cast<std::byte*>(mapping);
+
+    // The last user may drop the buffer on any thread, so it is only handed back here and reclaimed by `collect`
+    auto release_buffer = [this](PixelBuffer* buffer) {
+        release(*buffer);
+        delete buffer;
+    };
+    return std::shared_ptr<PixelBuffer>{new PixelBuffer{buffer}, release_buffer};
+}
+
+bool PixelBufferPool::bind_for_upload(PixelBuffer& buffer)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+    auto const success = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    buffer.mapping = nullptr;
+    return success;
+}
+
+void PixelBufferPool::finish_upload(PixelBuffer& buffer)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void PixelBufferPool::collect()
+{
+    auto released = std::vector<PixelBuffer>{};
+    {
+        auto lock = std::lock_guard<std::mutex>{m_released_mutex};
+        std::swap(released, m_released);
+    }
+
+    for (auto& buffer : released) {
+        // Dropped before the upload, e.g. because the texture load was cancelled
+        if (buffer.mapping) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            buffer.mapping = nullptr;
+        }
+
+        if (buffer.fence) {
+            m_in_flight.push_back(buffer);
+        } else {
+            recycle(buffer);
+        }
+    }
+
+    std::erase_if(m_in_flight, [&](auto& buffer) {
+        auto const status = glClientWaitSync(buffer.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            return false;
+        }
+
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+        recycle(buffer);
+        return true;
+    });
+}
+
+void PixelBufferPool::release(PixelBuffer const& buffer)
+{
+    auto lock = std::lock_guard<std::mutex>{m_released_mutex};
+    m_released.push_back(buffer);
+}
+
+void PixelBufferPool::recycle(PixelBuffer const& buffer)
+{
+    if (m_free_size + buffer.capacity > MAX_FREE_SIZE) {
+        destroy(buffer);
+        return;
+    }
+
+    m_free.push_back(buffer);
+    m_free_size += buffer.capacity;
+}
+
+void PixelBufferPool::destroy(PixelBuffer const& buffer)
+{
+    glDeleteBuffers(1, &buffer.id);
+}
@@ -19,10 +19,14 @@ auto const albedo_source = ShaderSource{
         uniform mat4 model;
         uniform mat4 view;
         uniform mat4 projection;
+        // Quantized positions are fractions of the mesh AABB, float positions use an offset of 0 and a scale of 1
+        uniform vec3 positionOffset;
+        uniform vec3 positionScale;
 
         void main() {
             TexCoords = aTexCoords;
-            gl_Position = projection * view * model * vec4(aPos, 1.0);
+            vec3 position = positionOffset + aPos * positionScale;
+            gl_Position = projection * view * model * vec4(position, 1.0);
         })",
 
     .fragment_shader = R"(
@@ -50,6 +54,8 @@ auto const albedo_source = ShaderSource{
         cache(locations.model, "model");
         cache(locations.view, "view");
         cache(locations.projection, "projection");
+        cache(locations.position_offset, "positionOffset");
+        cache(locations.position_scale, "positionScale");
 
         cache(locations.texture_diffuse, "texture_diffuse");
         cache(locations.texture_opacity, "texture_opacity");
@@ -72,14 +78,37 @@ auto const lighting_source = ShaderSource{
         uniform mat4 model;
         uniform mat4 view;
         uniform mat4 projection;
+        // Quantized positions are fractions of the mesh AABB, float positions use an offset of 0 and a scale of 1
+        uniform vec3 positionOffset;
+        uniform vec3 positionScale;
+        uniform bool octahedralNormals;
 
         out vec3 FragPos;
         out vec3 Normal;
         out vec2 TexCoords;
 
+        vec2 signNotZero(vec2 v) {
+            return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+        }
+
+        // The quantized normal is an octahedral encoding with both components mapped to [0, 1]
+        vec3 decodeNormal(vec3 normal) {
+            if (!octahedralNormals) {
+                return normal;
+            }
+
+            vec2 e = normal.xy * 2.0 - 1.0;
+            vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+            if (n.z < 0.0) {
+                n.xy = (1.0 - abs(e.yx)) * signNotZero(e);
+            }
+            return n;
+        }
+
         void main() {
-            FragPos = vec3(model * vec4(aPos, 1.0));
-            Normal = normalize(mat3(transpose(inverse(model))) * aNormal);
+            vec3 position = positionOffset + aPos * positionScale;
+            FragPos = vec3(model * vec4(position, 1.0));
+            Normal = normalize(mat3(transpose(inverse(model))) * decodeNormal(aNormal));
             TexCoords = aTexCoords;
             gl_Position = projection * view * vec4(FragPos, 1.0);
         })",
@@ -141,6 +170,9 @@ auto const lighting_source = ShaderSource{
         cache(locations.model, "model");
         cache(locations.view, "view");
         cache(locations.projection, "projection");
+        cache(locations.position_offset, "positionOffset");
+        cache(locations.position_scale, "positionScale");
+        cache(locations.octahedral_normals, "octahedralNormals");
 
         cache(locations.texture_diffuse, "texture_diffuse");
         cache(locations.texture_opacity, "texture_opacity");
@@ -221,10 +253,14 @@ auto const picking_source = ShaderSource{
         uniform mat4 model;
         uniform mat4 view;
         uniform mat4 projection;
+        // Quantized positions are fractions of the mesh AABB, float positions use an offset of 0 and a scale of 1
+        uniform vec3 positionOffset;
+        uniform vec3 positionScale;
 
         void main() {
             TexCoords = aTexCoords;
-            gl_Position = projection * view * model * vec4(aPos, 1.0);
+            vec3 position = positionOffset + aPos * positionScale;
+            gl_Position = projection * view * model * vec4(position, 1.0);
         })",
 
     .fragment_shader = R"(
@@ -243,6 +279,8 @@ auto const picking_source = ShaderSource{
         cache(locations.model, "model");
         cache(locations.view, "view");
         cache(locations.projection, "projection");
+        cache(locations.position_offset, "positionOffset");
+        cache(locations.position_scale, "positionScale");
 
         cache(locations.id, "id");
     },
@@ -0,0 +1,163 @@
+#include "renderer/StagingAllocator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Every block starts with its capacity, so `free` and `reallocate` know its size class. The header is allocated in
+// front of the payload, so a power of two request fills its size class instead of spilling into the next one.
+struct alignas(std::max_align_t) BlockHeader {
+    std::size_t capacity;
+};
+
+constexpr std::size_t MIN_CAPACITY = 4 * 1024;
+// Released blocks beyond this are returned to the system
+constexpr std::size_t MAX_POOLED_BYTES = 256 * 1024 * 1024;
+
+struct Pool {
+    std::mutex mutex;
+    // Indexed by the log2 of the capacity
+    std::array<std::vector<BlockHeader*>, 64> free_blocks;
+    StagingAllocator::Stats stats{.allocations = 0, .reuses = 0, .used_bytes = 0, .pooled_bytes = 0};
+
+    ~Pool()
+    {
+        for (auto const& blocks : free_blocks) {
+            for (auto* header : blocks) {
+                std::free(header);
+            }
+        }
+    }
+};
+
+Pool& pool()
+{
+    static Pool pool;
+    return pool;
+}
+
+BlockHeader* header_of(void* pointer)
+{
+    return static_cast<BlockHeader*>(pointer) - 1;
+}
+
+void* StagingAllocator::allocate(std::size_t size)
+{
+    auto const capacity = std::max(std::bit_ceil(size), MIN_CAPACITY);
+    auto& free_blocks = pool().free_blocks[std::countr_zero(capacity)];
+
+    {
+        auto lock = std::lock_guard<std::mutex>{pool().mutex};
+        pool().stats.used_bytes += capacity;
+        if (!free_blocks.empty()) {
+            auto* header = free_blocks.back();
+            free_blocks.pop_back();
+            pool().stats.pooled_bytes -= capacity;
+            ++pool().stats.reuses;
+            return header + 1;
+        }
+        ++pool().stats.allocations;
+    }
+
+    auto* header = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + capacity));
+    if (!header) {
+        auto lock = std::lock_guard<std::mutex>{pool().mutex};
+        pool().stats.used_bytes -= capacity;
+        return nullptr;
+    }
+
+    header->capacity = capacity;
+    return header + 1;
+}
+
+void* StagingAllocator::reallocate(void* pointer, std::size_t size)
+{
+    if (!pointer) {
+        return allocate(size);
+    }
+
+    auto const capacity = header_of(pointer)->capacity;
+    if (size <= capacity) {
+        return pointer;
+    }
+
+    auto* new_pointer = allocate(size);
+    if (!new_pointer) {
+        return nullptr;
+    }
+
+    std::memcpy(new_pointer, pointer, capacity);
+    free(pointer);
+    return new_pointer;
+}
+
+void StagingAllocator::free(void* pointer)
+{
+    if (!pointer) {
+        return;
+    }
+
+    auto* header = header_of(pointer);
+    auto const capacity = header->capacity;
+
+    {
+        auto lock = std::lock_guard<std::mutex>{pool().mutex};
+        pool().stats.used_bytes -= capacity;
+        if (pool().stats.pooled_bytes + capacity <= MAX_POOLED_BYTES) {
+            pool().free_blocks[std::countr_zero(capacity)].push_back(header);
+            pool().stats.pooled_bytes += capacity;
+            return;
+        }
+    }
+
+    std::free(header);
+}
+
+StagingAllocator::Stats StagingAllocator::stats()
+{
+    auto lock = std::lock_guard<std::mutex>{pool().mutex};
+    return pool().stats;
+}
+
+ImageData::ImageData(std::size_t size)
+    : m_data{size > 0 ? static_cast<unsigned char*>(StagingAllocator::allocate(size)) : nullptr}
+    , m_size{m_data ? size : 0}
+{ }
+
+ImageData ImageData::adopt(unsigned char* data, std::size_t size)
+{
+    auto image_data = ImageData{};
+    image_data.m_data = data;
+    image_data.m_size = size;
+    return image_data;
+}
+
+ImageData::ImageData(ImageData&& other)
+    : m_data{other.m_data}
+    , m_size{other.m_size}
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+ImageData& ImageData::operator=(ImageData&& other)
+{
+    if (this != &other) {
+        StagingAllocator::free(m_data);
+        m_data = other.m_data;
+        m_size = other.m_size;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+
+    return *this;
+}
+
+ImageData::~ImageData()
+{
+    StagingAllocator::free(m_data);
+}
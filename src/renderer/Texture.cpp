@@ -1,7 +1,45 @@
 #include "renderer/Texture.hpp"
 
+#include "core/AsyncTaskQueue.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <string_view>
+
+// From EXT_texture_compression_s3tc and EXT_texture_sRGB, glad is generated without extensions
+constexpr GLenum COMPRESSED_SRGB_S3TC_DXT1 = 0x8C4C;
+constexpr GLenum COMPRESSED_SRGB_ALPHA_S3TC_DXT5 = 0x8C4F;
+
+// Smaller images are downsampled on the calling thread
+constexpr std::size_t PARALLEL_PIXEL_COUNT = 256 * 256;
+
+struct SrgbTables {
+    std::array<float, 256> to_linear;
+    std::array<std::uint8_t, 4096> from_linear;
+};
+
+SrgbTables const& srgb_tables()
+{
+    static SrgbTables const tables = [] {
+        auto tables = SrgbTables{};
+        for (std::size_t i = 0; i < tables.to_linear.size(); ++i) {
+            auto const srgb = static_cast<float>(i) / 255.0f;
+            tables.to_linear[i] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+        }
+        for (std::size_t i = 0; i < tables.from_linear.size(); ++i) {
+            auto const linear = static_cast<float>(i) / static_cast<float>(tables.from_linear.size() - 1);
+            auto const srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            tables.from_linear[i] = static_cast<std::uint8_t>(std::clamp(std::round(srgb * 255.0f), 0.0f, 255.0f));
+        }
+        return tables;
+    }();
+
+    return tables;
+}
 
 std::optional<Image> Image::load_from_file(char const* path)
 {
@@ -23,22 +61,125 @@ std::optional<Image> Image::load_from_file(char const* path)
         return {};
     }
 
-    auto data_vector = std::vector<unsigned char>(data, data + n_components * width * height);
-    stbi_image_free(data);
-
+    // stb_image allocates from the `StagingAllocator` (see vendor/stb_image.cpp), so the pixels are used as they are
     return Image{
         .width = width,
         .height = height,
         .channels = n_components,
-        .data = std::move(data_vector),
+        .data = ImageData::adopt(data, static_cast<std::size_t>(n_components) * width * height),
+        .mips = {},
     };
 }
 
-std::optional<Texture> Texture::load_from_image(Image image)
+Image Image::downsample() const
 {
-    unsigned int texture_id;
-    glGenTextures(1, &texture_id);
+    auto next = Image{
+        .width = std::max(width / 2, 1),
+        .height = std::max(height / 2, 1),
+        .channels = channels,
+        .data = ImageData{static_cast<std::size_t>(std::max(width / 2, 1)) * std::max(height / 2, 1) * channels},
+        .mips = {},
+    };
+
+    auto const& tables = srgb_tables();
+    // Scalar on purpose, an SSE2 kernel that evaluates the sRGB curves as polynomials was 2-5x slower than the table lookups
+    auto const srgb_channels = channels >= 3 ? 3 : 0;
+    auto const stride = static_cast<std::size_t>(width) * channels;
+
+    auto downsample_row = [&](std::size_t y) {
+        // The last row and column are repeated for odd sizes
+        auto const* row0 = &data[std::min(2 * y, static_cast<std::size_t>(height - 1)) * stride];
+        auto const* row1 = &data[std::min(2 * y + 1, static_cast<std::size_t>(height - 1)) * stride];
+        auto* out = &next.data[y * next.width * channels];
+
+        for (int x = 0; x < next.width; ++x) {
+            auto const x0 = static_cast<std::size_t>(std::min(2 * x, width - 1)) * channels;
+            auto const x1 = static_cast<std::size_t>(std::min(2 * x + 1, width - 1)) * channels;
+            for (int c = 0; c < channels; ++c) {
+                if (c < srgb_channels) {
+                    auto const linear = tables.to_linear[row0[x0 + c]] + tables.to_linear[row0[x1 + c]]
+                        + tables.to_linear[row1[x0 + c]] + tables.to_linear[row1[x1 + c]];
+                    *out++ = tables.from_linear[static_cast<std::size_t>(linear / 4.0f * (tables.from_linear.size() - 1) + 0.5f)];
+                } else {
+                    *out++ = static_cast<unsigned char>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+    };
+
+    auto const rows = static_cast<std::size_t>(next.height);
+    if (rows * next.width >= PARALLEL_PIXEL_COUNT) {
+        AsyncTaskQueue::background.parallel_for(rows, downsample_row);
+    } else {
+        for (std::size_t y = 0; y < rows; ++y) {
+            downsample_row(y);
+        }
+    }
+
+    return next;
+}
+
+void Image::generate_mips()
+{
+    mips.clear();
+    while (true) {
+        auto const& level = mips.empty() ? *this : mips.back();
+        if (level.width == 1 && level.height == 1) {
+            break;
+        }
+        auto next = level.downsample();
+        mips.push_back(std::move(next));
+    }
+}
+
+std::size_t Image::byte_size() const
+{
+    auto size = data.size();
+    for (auto const& mip : mips) {
+        size += mip.data.size();
+    }
+    return size;
+}
+
+void Image::copy_to(std::byte* destination) const
+{
+    std::memcpy(destination, data.data(), data.size());
+    destination += data.size();
+    for (auto const& mip : mips) {
+        std::memcpy(destination, mip.data.data(), mip.data.size());
+        destination += mip.data.size();
+    }
+}
+
+// Drivers store RGB textures with 4 bytes per pixel
+std::size_t estimate_memory_size(Image const& image)
+{
+    auto const bytes_per_pixel = static_cast<std::size_t>(image.channels == 1 ? 1 : 4);
+    auto size = static_cast<std::size_t>(image.width) * image.height * bytes_per_pixel;
+    if (image.mips.empty()) {
+        // Generated by the driver
+        return size * 4 / 3;
+    }
+
+    for (auto const& mip : image.mips) {
+        size += static_cast<std::size_t>(mip.width) * mip.height * bytes_per_pixel;
+    }
+    return size;
+}
+
+std::size_t estimate_memory_size(CompressedImage const& image)
+{
+    auto size = std::size_t{0};
+    for (auto const& mip : image.mips) {
+        size += mip.size;
+    }
+    return size;
+}
 
+// `levels` holds a pointer to the pixels of every level, or an offset into the bound pixel buffer.
+// Returns 0 if the image has an unsupported number of channels.
+unsigned int upload_image(Image const& image, std::span<void const* const> levels)
+{
     GLenum format{};
     GLenum internal_format{};
     switch (image.channels) {
@@ -52,29 +193,189 @@ std::optional<Texture> Texture::load_from_image(Image image)
         break;
     case 4:
         internal_format = GL_SRGB_ALPHA;
-        format = GL_RGB;
+        format = GL_RGBA;
         break;
     default:
-        glDeleteTextures(1, &texture_id);
+        return 0;
+    }
+
+    unsigned int texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    // Rows of RGB and single channel images are tightly packed, not padded to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, levels[0]);
+    if (image.mips.empty()) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    } else {
+        for (std::size_t i = 0; i < image.mips.size(); ++i) {
+            auto const& mip = image.mips[i];
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), internal_format, mip.width, mip.height, 0, format, GL_UNSIGNED_BYTE, levels[i + 1]);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.mips.size()));
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return texture_id;
+}
+
+std::optional<Texture> Texture::load_from_image(Image image)
+{
+    auto levels = std::vector<void const*>{image.data.data()};
+    for (auto const& mip : image.mips) {
+        levels.push_back(mip.data.data());
+    }
+
+    auto const texture_id = upload_image(image, levels);
+    if (texture_id == 0) {
         return {};
     }
 
+    auto texture = Texture{
+        texture_id,
+        image.width,
+        image.height,
+        image.channels,
+        true,
+    };
+    texture.memory_size = estimate_memory_size(image);
+    return texture;
+}
+
+std::optional<Texture> Texture::load_from_pixel_buffer(Image const& image)
+{
+    // The levels were copied back to back by `Image::copy_to`
+    auto levels = std::vector<void const*>{};
+    std::size_t offset = 0;
+    auto add_level = [&](Image const& level) {
+        levels.push_back(reinterpret_cast<void const*>(offset));
+        offset += static_cast<std::size_t>(level.width) * level.height * level.channels;
+    };
+    add_level(image);
+    for (auto const& mip : image.mips) {
+        add_level(mip);
+    }
+
+    auto const texture_id = upload_image(image, levels);
+    if (texture_id == 0) {
+        return {};
+    }
+
+    auto texture = Texture{
+        texture_id,
+        image.width,
+        image.height,
+        image.channels,
+        true,
+    };
+    texture.memory_size = estimate_memory_size(image);
+    return texture;
+}
+
+std::size_t CompressedImage::block_size(CompressedFormat format)
+{
+    return format == CompressedFormat::BC3_SRGB ? 16 : 8;
+}
+
+// `base` is the start of the data in memory, or nullptr if the data is in the bound pixel buffer.
+// Returns 0 if the format is unknown.
+unsigned int upload_compressed(CompressedImage const& image, std::byte const* base)
+{
+    GLenum internal_format{};
+    switch (image.format) {
+    case CompressedFormat::BC1_SRGB:
+        internal_format = COMPRESSED_SRGB_S3TC_DXT1;
+        break;
+    case CompressedFormat::BC3_SRGB:
+        internal_format = COMPRESSED_SRGB_ALPHA_S3TC_DXT5;
+        break;
+    case CompressedFormat::BC4:
+        internal_format = GL_COMPRESSED_RED_RGTC1;
+        break;
+    default:
+        return 0;
+    }
+
+    if (image.mips.empty()) {
+        return 0;
+    }
+
+    unsigned int texture_id;
+    glGenTextures(1, &texture_id);
     glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data.data());
-    glGenerateMipmap(GL_TEXTURE_2D);
 
+    for (std::size_t level = 0; level < image.mips.size(); ++level) {
+        auto const& mip = image.mips[level];
+        auto const* pixels = reinterpret_cast<void const*>(reinterpret_cast<std::uintptr_t>(base) + mip.offset);
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internal_format, mip.width, mip.height, 0, static_cast<GLsizei>(mip.size), pixels);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.mips.size() - 1));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    return Texture{
+    return texture_id;
+}
+
+std::optional<Texture> Texture::load_from_compressed(CompressedImage const& image)
+{
+    auto const texture_id = upload_compressed(image, image.data.data());
+    if (texture_id == 0) {
+        return {};
+    }
+
+    auto texture = Texture{
         texture_id,
         image.width,
         image.height,
         image.channels,
         true,
     };
+    texture.memory_size = estimate_memory_size(image);
+    return texture;
+}
+
+std::optional<Texture> Texture::load_from_pixel_buffer(CompressedImage const& image)
+{
+    auto const texture_id = upload_compressed(image, nullptr);
+    if (texture_id == 0) {
+        return {};
+    }
+
+    auto texture = Texture{
+        texture_id,
+        image.width,
+        image.height,
+        image.channels,
+        true,
+    };
+    texture.memory_size = estimate_memory_size(image);
+    return texture;
+}
+
+bool Texture::supports_compression()
+{
+    // RGTC is core since OpenGL 3.0. The sRGB variants of S3TC come from EXT_texture_sRGB,
+    // which every desktop driver that supports S3TC also supports.
+    static bool const supported = [] {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            auto const* name = reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (name && std::string_view{name} == "GL_EXT_texture_compression_s3tc") {
+                return true;
+            }
+        }
+        return false;
+    }();
+
+    return supported;
 }
 
 Texture Texture::fallback_placeholder(unsigned int id)
@@ -103,6 +404,8 @@ Texture::Texture(Texture&& other)
     , height{other.height}
     , channels{other.channels}
     , is_loaded{other.is_loaded}
+    , memory_size{other.memory_size}
+    , last_used_frame{other.last_used_frame}
 {
     // Important: Destructor will be called after move!
     other.id = 0;
@@ -116,6 +419,8 @@ Texture& Texture::operator=(Texture&& other)
         height = other.height;
         channels = other.channels;
         is_loaded = other.is_loaded;
+        memory_size = other.memory_size;
+        last_used_frame = other.last_used_frame;
 
         // Important: Destructor will be called after move!
         other.id = 0;
@@ -78,6 +78,11 @@ void AssetBrowser::traverse_directory(FSCacheNode const& node)
             int flags = is_selected_item_equal(model) ? ImGuiTreeNodeFlags_Selected : ImGuiTreeNodeFlags_None;
             bool open = ImGui::TreeNodeEx(entry.path.filename().string().c_str(), flags);
 
+            if (auto progress = Project::get_current()->model_load_progress(model); progress.has_value()) {
+                ImGui::SameLine();
+                ImGui::ProgressBar(progress.value(), ImVec2{100.0f, 0.0f});
+            }
+
             if (ImGui::BeginDragDropSource()) {
                 if (!model) {
                     model = Project::get_current()->get_model(entry.path);
@@ -137,6 +142,11 @@ void AssetBrowser::render()
 
         if (ImGui::BeginChild("preview")) {
             prepare_preview();
+            if (m_preview_image) {
+                // Drawn this frame, so it isn't evicted while it's shown
+                m_preview_image->last_used_frame = Project::get_current()->frame();
+                m_preview_texture = m_preview_image->id;
+            }
             ImGui::Text("%s", m_preview_name.c_str());
             if (m_preview_texture) {
                 ImGui::Image(m_preview_texture, ImVec2{static_cast<float>(m_model_preview_framebuffer.width), static_cast<float>(m_model_preview_framebuffer.height)}, ImVec2{0.0f, 1.0f}, ImVec2{1.0f, 0.0f});
@@ -148,13 +158,16 @@ void AssetBrowser::render()
                 if (auto* value = std::get_if<Node const*>(&m_selected_item.value()); value != nullptr) {
                     auto node = *value;
                     ImGui::Text("Model node");
+                    if (auto progress = Project::get_current()->model_load_progress(node); progress.has_value()) {
+                        ImGui::ProgressBar(progress.value());
+                    }
                     ImGui::Text("Meshes: %zu", node->meshes.size());
                     ImGui::Text("Direct children: %zu", node->children.size());
                 }
                 if (auto* value = std::get_if<std::filesystem::path>(&m_selected_item.value()); value != nullptr) {
                     auto node = Project::get_current()->get_fs_cache(*value);
                     if (node && node->type == FSCacheNode::Type::TEXTURE) {
-                        auto texture = Project::get_current()->get_texture(*value);
+                        auto texture = Project::get_current()->get_texture(*value, AsyncTaskQueue::Priority::VISIBLE_NOW);
                         if (texture) {
                             ImGui::Text("Filetype: ? Image"); // TODO: Get image format?
                             ImGui::Text("Size: %d x %d", texture->width, texture->height);
@@ -178,6 +191,7 @@ void AssetBrowser::prepare_preview()
 
     m_preview_dirty = false;
     m_preview_texture = 0;
+    m_preview_image = nullptr;
 
     if (!m_selected_item.has_value()) {
         return;
@@ -197,8 +211,8 @@ void AssetBrowser::prepare_preview()
         m_preview_name = value->filename().string();
         auto node = Project::get_current()->get_fs_cache(*value);
         if (node && node->type == FSCacheNode::Type::TEXTURE) {
-            auto texture = Project::get_current()->get_texture(*value);
-            m_preview_texture = texture->id;
+            auto texture = Project::get_current()->get_texture(*value, AsyncTaskQueue::Priority::VISIBLE_NOW);
+            m_preview_image = texture;
             if (!texture->is_loaded) {
                 m_preview_dirty = true;
             }
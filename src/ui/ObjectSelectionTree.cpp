@@ -35,8 +35,11 @@ void ObjectSelectionTree::traverse_nodes(InstancedNode& root)
         auto is_selected = child == project->selected_node;
 
         if (ImGui::IsWindowFocused() && is_selected && ImGui::IsKeyPressed(ImGuiKey_Delete, false)) {
+            auto removed_node = std::move(root.children[index]);
             root.children.erase(root.children.begin() + index--);
             project->selected_node = nullptr;
+            project->release_textures(*removed_node);
+            project->scene->compute_transforms();
             continue;
         }
 
@@ -2,6 +2,7 @@
 
 #include "core/AsyncTaskQueue.hpp"
 #include "core/Project.hpp"
+#include "renderer/StagingAllocator.hpp"
 #include <imgui.h>
 
 void Performance::render(double delta_time)
@@ -31,8 +32,20 @@ void Performance::render(double delta_time)
         ImGui::Text("current background tasks: %zu", AsyncTaskQueue::background.num_queued_tasks());
         ImGui::Text("total background tasks over %f s: %zu", m_update_interval, m_total_background_tasks - m_last_total_background_tasks);
         ImGui::Text("total background tasks: %zu", AsyncTaskQueue::background.num_total_queued_tasks());
+
+        auto const main_thread_result = AsyncTaskQueue::main.last_run_result();
+        ImGui::Text("main thread tasks last frame: %zu", main_thread_result.tasks_run);
+        ImGui::Text("main thread tasks left over: %zu", main_thread_result.tasks_left);
+        ImGui::Text("main thread budget left: %lld us", static_cast<long long>(main_thread_result.time_left.count()));
         ImGui::Text("total models: %zu", project->m_models.size());
+        ImGui::Text("models loading: %zu", project->num_model_loads());
+        ImGui::Text("mesh data released from RAM: %.1f MiB", static_cast<double>(Mesh::released_bytes()) / (1024.0 * 1024.0));
         ImGui::Text("total textures: %zu", project->m_textures.size());
+        ImGui::Text("texture memory: %.1f / %.0f MiB, evicted: %zu", static_cast<double>(project->m_texture_memory) / (1024.0 * 1024.0), static_cast<double>(project->config.texture_memory_budget), project->m_evicted_textures);
+
+        auto const staging = StagingAllocator::stats();
+        ImGui::Text("image buffer allocations: %zu, reused: %zu", staging.allocations, staging.reuses);
+        ImGui::Text("image buffers in use: %.1f MiB, pooled: %.1f MiB", static_cast<double>(staging.used_bytes) / (1024.0 * 1024.0), static_cast<double>(staging.pooled_bytes) / (1024.0 * 1024.0));
     }
     ImGui::End();
 }
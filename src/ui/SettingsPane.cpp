@@ -38,6 +38,8 @@ void SettingsPane::render()
 
         ImGui::InputFloat("near", &config.near, 1.0f);
         ImGui::InputFloat("far", &config.far, 1.0f);
+        ImGui::SliderFloat("LOD Pixel Error", &config.lod_pixel_error, 0.0f, 8.0f);
+        ImGui::SliderFloat("HLOD Pixel Size", &config.hlod_pixel_size, 0.0f, 256.0f);
 
         // Lighting Controls
         ImGui::SeparatorText("Lighting Controls");
@@ -73,6 +75,23 @@ void SettingsPane::render()
         ImGui::SeparatorText("Textures");
 
         ImGui::ColorEdit3("Fallback Texture Color", &config.fallback_color[0]);
+        ImGui::Checkbox("Compress Textures", &config.compress_textures);
+
+        ImGui::SeparatorText("Streaming");
+
+        ImGui::SliderFloat("Main Thread Budget ms/frame", &config.main_thread_budget, 0.5f, 16.0f);
+        ImGui::Checkbox("Keep Mesh Data in RAM", &config.keep_mesh_data);
+        ImGui::InputFloat("Texture Memory Budget MiB", &config.texture_memory_budget, 256.0f);
+
+        ImGui::SeparatorText("Import");
+
+        ImGui::Checkbox("Quantize Vertices of New Models", &config.quantize_vertices);
+        ImGui::Checkbox("Weld Vertices of New Models", &config.weld_vertices);
+        ImGui::InputFloat("Weld Position Epsilon", &config.weld_position_epsilon, 0.01f);
+        ImGui::InputFloat("Weld Normal Epsilon", &config.weld_normal_epsilon, 0.01f);
+        ImGui::InputFloat("Weld UV Epsilon", &config.weld_tex_coords_epsilon, 0.001f);
+        ImGui::Checkbox("Optimize Meshes of New Models", &config.optimize_meshes);
+        ImGui::Checkbox("Generate LODs of New Models", &config.generate_lods);
     }
     ImGui::End();
 }